@@ -0,0 +1,66 @@
+#!/bin/sh
+#
+# parsers.sh - Bison's LALR tables against --parser=rd on expressions,
+#              in the a1 dialect
+#
+# Usage: sh ASSIGNMENT1/bench/parsers.sh ./c_parser [statements]
+#
+# Writes three expression-heavy programs (default 200000 statements
+# each): flat chains over every precedence level, deeply parenthesised
+# arithmetic, and subscripts with constant folding; then times each
+# parser over each, best of three.  Both share the flex scanner, so the
+# difference is the parser alone.
+
+PARSER=${1:-./c_parser}
+N=${2:-200000}
+DIR=${TMPDIR:-/tmp}/parsers.$$
+trap 'rm -rf "$DIR"' EXIT INT TERM
+
+mkdir -p "$DIR"
+awk -v n="$N" -v dir="$DIR" 'BEGIN {
+    f = dir "/chains.c"
+    print "int a, b, c, d, e;" > f
+    for (i = 0; i < n; i++)
+        print "a = b * c + d / e - a % 7 < b || c == d && e != -a + !b;" > f
+    close(f)
+
+    f = dir "/parens.c"
+    print "int a, b;" > f
+    for (i = 0; i < n; i++)
+        print "a = ((((a + 1) * (b - 2)) / ((a + 3) % (b + 4))) - " \
+              "(((1 + 2) * 3) - (4 * (5 + 6))));" > f
+    close(f)
+
+    f = dir "/subscripts.c"
+    print "int m[8][8], i, j;" > f
+    for (i = 0; i < n; i++)
+        print "i = m[i + 1][2 * 3 - 1] + m[7 - 1][j] * m[(1 + 2) * 2][i - j];" > f
+    close(f)
+}'
+
+now_ns() {
+    date +%s%N
+}
+
+best() {
+    b=
+    for run in 1 2 3; do
+        start=$(now_ns)
+        "$PARSER" --dialect=a1 --check-bounds "$@" < "$file" \
+            > /dev/null 2>&1
+        end=$(now_ns)
+        ns=$((end - start))
+        [ -z "$b" ] || [ "$ns" -lt "$b" ] && b=$ns
+    done
+    echo "$b"
+}
+
+printf "%-12s %10s %10s %8s\n" corpus lalr-ms rd-ms speedup
+for name in chains parens subscripts; do
+    file="$DIR/$name.c"
+    lalr=$(best --parser=lalr)
+    rd=$(best --parser=rd)
+    awk -v c="$name" -v l="$lalr" -v r="$rd" 'BEGIN {
+        printf "%-12s %10.1f %10.1f %7.2fx\n", c, l / 1e6, r / 1e6, l / r
+    }'
+done
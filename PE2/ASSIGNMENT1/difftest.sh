@@ -0,0 +1,163 @@
+#!/bin/sh
+#
+# difftest.sh - Differential test: --parser=rd against the Bison parser
+#               of the a1 dialect
+#
+# Usage: sh ASSIGNMENT1/difftest.sh ./c_parser [programs] [seed]
+#
+# Generates random programs over the whole grammar (default 2000), and
+# for every other one a copy with one token deleted, duplicated or
+# replaced, then runs both parsers on each, with and without
+# --check-bounds (where the grouping of operators decides the folded
+# subscripts).  Exit status, stdout and stderr must be identical;
+# the first few differences are shown and the script fails if any.
+
+PARSER=${1:-./c_parser}
+N=${2:-2000}
+SEED=${3:-1}
+DIR=${TMPDIR:-/tmp}/difftest.$$
+trap 'rm -rf "$DIR"' EXIT INT TERM
+
+mkdir -p "$DIR"
+awk -v n="$N" -v seed="$SEED" -v dir="$DIR" '
+function pick(s,    a, k) {
+    k = split(s, a, " ")
+    return a[int(rand() * k) + 1]
+}
+function id() { return pick("a b c i j n arr m") }
+function num() { return rand() < 0.8 ? int(rand() * 12) - 1 : "2.5" }
+function operand(d,    r) {
+    r = rand()
+    if (d <= 0 || r < 0.30) return rand() < 0.5 && !consts ? id() : num()
+    if (r < 0.40) return "( " expr(d - 1) " )"
+    if (r < 0.50) return "- " operand(d - 1)
+    if (r < 0.58) return "! " expr(d - 1)
+    if (r < 0.66) return id() " " pick("++ --")
+    if (r < 0.72) return pick("++ --") " " id()
+    if (r < 0.86) return pick("arr m") " [ " subscript(d - 1) " ]" \
+                         (rand() < 0.4 ? " [ " subscript(d - 1) " ]" : "")
+    return operand(0)
+}
+# mostly constant, so that --check-bounds has something to fold
+function subscript(d,    c, e) {
+    c = consts
+    consts = 1
+    e = expr(d)
+    consts = c
+    return e
+}
+function expr(d,    e, k) {
+    e = operand(d)
+    for (k = int(rand() * 4); k > 0; k--)
+        e = e " " pick("+ - * / % == != < > <= >= && ||") " " operand(d)
+    return e
+}
+function type() { return pick("int float char double") }
+function decl(    s, k) {
+    s = type() " " declarator()
+    for (k = int(rand() * 3); k > 0; k--)
+        s = s " , " declarator()
+    return s " ;"
+}
+function declarator(    s) {
+    s = id()
+    if (rand() < 0.4) {
+        s = s " [ " num() " ]"
+        if (rand() < 0.5) s = s " [ " num() " ]"
+    }
+    if (rand() < 0.3) s = s " = " expr(2)
+    return s
+}
+function list(d, k,    s) {
+    s = ""
+    for (; k > 0; k--)
+        s = s stmt(d) "\n"
+    return s
+}
+function for_item(upd) {
+    if (upd) {
+        if (rand() < 0.3) return pick("++ --") " " id()
+        if (rand() < 0.5) return id() " " pick("++ --")
+        return id() " " pick("= += -=") " " expr(1)
+    }
+    return (rand() < 0.3 ? type() " " : "") id() " = " expr(1)
+}
+function stmt(d,    r, s, k) {
+    r = rand()
+    if (d <= 0 || r < 0.25) {
+        r = rand()
+        if (r < 0.35) return id() " " pick("= += -=") " " expr(3) " ;"
+        if (r < 0.45) return id() " " pick("++ --") " ;"
+        if (r < 0.75) return decl()
+        if (r < 0.80) return "break ;"
+        return expr(3) " ;"
+    }
+    if (r < 0.40) {
+        s = "if ( " expr(2) " ) " stmt(d - 1)
+        return rand() < 0.5 ? s " else " stmt(d - 1) : s
+    }
+    if (r < 0.50) return "do " stmt(d - 1) " while ( " expr(2) " ) ;"
+    if (r < 0.60) return "while ( " expr(2) " ) " stmt(d - 1)
+    if (r < 0.72)
+        return "for ( " (rand() < 0.8 ? for_item(0) : "") \
+               (rand() < 0.3 ? " , " for_item(0) : "") " ; " \
+               (rand() < 0.8 ? expr(2) : "") " ; " \
+               (rand() < 0.8 ? for_item(1) : "") \
+               (rand() < 0.3 ? " , " for_item(1) : "") " ) " stmt(d - 1)
+    if (r < 0.82) {
+        s = "switch ( " expr(1) " ) {\n"
+        for (k = int(rand() * 3); k > 0; k--)
+            s = s "case " (rand() < 0.7 ? num() : id()) " :\n" \
+                  list(d - 1, int(rand() * 3))
+        if (rand() < 0.5) s = s "default :\n" list(d - 1, int(rand() * 3))
+        return s "}"
+    }
+    return "{\n" list(d - 1, int(rand() * 4)) "}"
+}
+BEGIN {
+    srand(seed)
+    pool = "int float if else do while for switch case default break " \
+           "a 7 ++ -- += -= == != <= >= && || < > + - * / % = ! : ; , " \
+           "( ) { } [ ]"
+    for (f = 0; f < n; f++) {
+        prog = "int arr [ 4 ] , m [ 3 ] [ 5 ] ;\n" list(3, 1 + int(rand() * 6))
+        file = sprintf("%s/p%05d.c", dir, f)
+        if (f % 2) {
+            k = split(prog, t, "[ ]")
+            i = int(rand() * k) + 1
+            r = rand()
+            if (r < 0.4)      t[i] = ""
+            else if (r < 0.6) t[i] = t[i] " " t[i]
+            else              t[i] = pick(pool)
+            prog = t[1]
+            for (j = 2; j <= k; j++)
+                prog = prog " " t[j]
+        }
+        print prog > file
+        close(file)
+    }
+}'
+
+fails=0
+for f in "$DIR"/p*.c; do
+    for opt in "" --check-bounds; do
+        "$PARSER" --dialect=a1 $opt < "$f" > "$DIR/lalr.out" 2>&1
+        echo "exit $?" >> "$DIR/lalr.out"
+        "$PARSER" --dialect=a1 $opt --parser=rd < "$f" > "$DIR/rd.out" 2>&1
+        echo "exit $?" >> "$DIR/rd.out"
+        if ! cmp -s "$DIR/lalr.out" "$DIR/rd.out"; then
+            fails=$((fails + 1))
+            if [ "$fails" -le 3 ]; then
+                echo "--- $opt $(basename "$f"):"
+                cat "$f"
+                diff "$DIR/lalr.out" "$DIR/rd.out"
+            fi
+        fi
+    done
+done
+
+valid=$(for f in "$DIR"/p*.c; do
+    "$PARSER" --dialect=a1 < "$f" > /dev/null 2>&1 && echo
+done | wc -l)
+echo "$N programs ($valid valid), $fails difference(s)"
+[ "$fails" -eq 0 ]
@@ -0,0 +1,133 @@
+/*
+ * arrays.c - Array layout and bounds metadata (see arrays.h)
+ *
+ * Arrays live in an open-addressing hash table keyed on the name, so a
+ * lookup from an index_list costs one hash and usually one probe no
+ * matter how many arrays a generated program declares.
+ */
+
+#include "arrays.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "strbuf.h"
+
+/* ================================================================
+   Subscript lists
+   ================================================================ */
+struct subscript_list *subscripts_new(void) {
+    struct subscript_list *list = xmalloc(sizeof *list);
+    list->count = 0;
+    list->cap   = 4;
+    list->items = xmalloc(list->cap * sizeof *list->items);
+    return list;
+}
+
+void subscripts_push(struct subscript_list *list, struct cexpr item) {
+    if (list->count == list->cap) {
+        list->cap *= 2;
+        list->items = xrealloc(list->items,
+                               list->cap * sizeof *list->items);
+    }
+    list->items[list->count++] = item;
+}
+
+void subscripts_free(struct subscript_list *list) {
+    if (!list)
+        return;
+    free(list->items);
+    free(list);
+}
+
+/* ================================================================
+   Array table
+   ================================================================ */
+static size_t hash_name(const char *s) {
+    size_t h = 14695981039346656037UL;     /* FNV-1a */
+    while (*s) {
+        h ^= (unsigned char) *s++;
+        h *= 1099511628211UL;
+    }
+    return h;
+}
+
+static size_t find_slot(struct array_info **table, size_t n,
+                        const char *name) {
+    size_t i = hash_name(name) & (n - 1);
+    while (table[i] && strcmp(table[i]->name, name) != 0)
+        i = (i + 1) & (n - 1);
+    return i;
+}
+
+static void free_info(struct array_info *a) {
+    free(a->name);
+    free(a->dims);
+    free(a);
+}
+
+static void grow_table(struct array_table *t) {
+    size_t n = t->nslots ? t->nslots * 2 : 64;
+    struct array_info **table = xcalloc(n, sizeof *table);
+    for (size_t i = 0; i < t->nslots; i++)
+        if (t->slots[i])
+            table[find_slot(table, n, t->slots[i]->name)] = t->slots[i];
+    free(t->slots);
+    t->slots  = table;
+    t->nslots = n;
+}
+
+const struct array_info *array_declare(struct array_table *t, char *name,
+                                       const struct subscript_list *dims,
+                                       size_t offset) {
+    struct array_info *a = xmalloc(sizeof *a);
+    int rank = dims->count;
+
+    a->name = name;
+    a->rank = rank;
+    a->offset = offset;
+    /* dims and strides share one allocation */
+    a->dims    = xmalloc(2 * rank * sizeof *a->dims);
+    a->strides = a->dims + rank;
+
+    /* Row-major: the last subscript varies fastest.  An unknown
+       extent, or a product too large for a long, leaves no layout. */
+    long stride = 1;
+    for (int i = rank - 1; i >= 0; i--) {
+        const struct cexpr *d = &dims->items[i];
+        a->dims[i]    = (d->known && d->value > 0) ? d->value : 0;
+        a->strides[i] = stride;
+        if (stride >= 0 && (a->dims[i] == 0 ||
+            __builtin_mul_overflow(stride, a->dims[i], &stride)))
+            stride = -1;
+    }
+    a->size = stride;
+    if (stride < 0)
+        memset(a->strides, 0, rank * sizeof *a->strides);
+
+    if (2 * (t->nused + 1) > t->nslots)
+        grow_table(t);
+    size_t i = find_slot(t->slots, t->nslots, name);
+    if (t->slots[i])
+        free_info(t->slots[i]);       /* redeclaration replaces */
+    else
+        t->nused++;
+    t->slots[i] = a;
+    return a;
+}
+
+const struct array_info *array_lookup(const struct array_table *t,
+                                      const char *name) {
+    if (!t->nslots)
+        return NULL;
+    return t->slots[find_slot(t->slots, t->nslots, name)];
+}
+
+void arrays_reset(struct array_table *t) {
+    for (size_t i = 0; i < t->nslots; i++)
+        if (t->slots[i])
+            free_info(t->slots[i]);
+    free(t->slots);
+    t->slots  = NULL;
+    t->nslots = t->nused = 0;
+}
@@ -0,0 +1,92 @@
+/*
+ * arrays.h - Array layout and bounds metadata
+ *
+ * Every declarator with a dim_list ("int cube[1][2][3][4];") is recorded
+ * here at parse time.  The row-major strides are computed once, when the
+ * array is declared, so an evaluator or code generator can turn a list
+ * of subscripts into a flat element offset with one multiply-add per
+ * dimension:
+ *
+ *     offset = idx[0]*strides[0] + idx[1]*strides[1] + ... + idx[n-1]
+ *
+ * An array with an extent that is not a positive literal, or with more
+ * elements than a long can count, has no layout: its size is -1 and
+ * only the extents that are known can be checked.
+ *
+ * The grammar has no scoping rules, so a table is flat: a later
+ * declaration of the same name replaces the earlier one.  Each parser
+ * instance has a table of its own.
+ */
+
+#ifndef ARRAYS_H
+#define ARRAYS_H
+
+#include <stddef.h>
+
+/* Compile-time value of an expression (used for constant subscripts) */
+struct cexpr {
+    int  known;   /* 1 if the expression folded to a constant */
+    long value;   /* the constant, valid only when known      */
+};
+
+/* Extents of a dim_list, or the subscripts of an index_list */
+struct subscript_list {
+    int            count;
+    int            cap;
+    struct cexpr  *items;
+};
+
+/* One declared array */
+struct array_info {
+    char  *name;
+    int    rank;      /* number of dimensions                          */
+    long  *dims;      /* extent of each dimension, outermost first;
+                         0 when the extent is not an integer literal   */
+    long  *strides;   /* row-major multipliers, strides[rank-1] == 1;
+                         all 0 when there is no layout                 */
+    long   size;      /* total element count, or -1 for no layout: an
+                         extent is 0 or the count overflows a long     */
+    size_t offset;    /* where it is declared, in bytes: a diagnostic
+                         that needs its line asks parser_line_of()     */
+};
+
+/* ── Subscript lists (built up while dim_list / index_list reduce) ── */
+struct subscript_list *subscripts_new(void);
+void subscripts_push(struct subscript_list *list, struct cexpr item);
+void subscripts_free(struct subscript_list *list);
+
+/* ── Array table ── */
+
+/* Open-addressing hash table keyed on the name; zero-initialised */
+struct array_table {
+    struct array_info **slots;     /* NULL = empty slot       */
+    size_t              nslots;    /* always a power of two   */
+    size_t              nused;
+};
+
+/* Record an array; takes ownership of name, copies the extents */
+const struct array_info *array_declare(struct array_table *t, char *name,
+                                       const struct subscript_list *dims,
+                                       size_t offset);
+
+/* Look up the most recent declaration of name (NULL if none) */
+const struct array_info *array_lookup(const struct array_table *t,
+                                      const char *name);
+
+/* Forget every recorded array */
+void arrays_reset(struct array_table *t);
+
+/* Flat row-major element offset of idx[0..rank-1] (no bounds check),
+   or -1 if the array has no layout */
+static inline long array_flat_index(const struct array_info *a,
+                                    const long *idx) {
+    long offset = 0;
+
+    if (a->size < 0)
+        return -1;
+    for (int i = 0; i < a->rank; i++)
+        offset += idx[i] * a->strides[i];
+    return offset;
+}
+
+#endif /* ARRAYS_H */
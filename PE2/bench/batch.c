@@ -0,0 +1,92 @@
+/*
+ * batch.c - Parsing with the scanner run a batch of tokens at a time
+ *
+ *     ./bench/batch [MB] [pe2|a1]
+ *
+ * Generates code of 1, 4, ... up to MB (default 64) megabytes and
+ * parses it with token_batch 0 (the parser calls the scanner for each
+ * token) and then 64 .. 4096 (the scanner fills a ring of that many
+ * tokens, and the parser empties it; see tokens.h).  Every parse must
+ * find the code valid.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../parser.h"
+#include "../strbuf.h"
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static void generate(struct strbuf *src, size_t bytes, int a1) {
+    static const char *lines[] = {
+        "int a, b = 12, c;\n",
+        "if (a < b) { b = b * 2 - 1; } else { a = -a; } // a /* b\n",
+        "/* a comment\n   over lines */ x = 3.25 * y - (a + b) / 4;\n",
+        "do { a = a - 1; { b = b + a; } } while (a > 0);\n",
+        "while (i < 10) { i += 2; x = a[i] && b || c; }\n",
+        "for (i = 0, j = 9; i < j; i++, j--) x = a[i][j];\n",
+    };
+    unsigned k = 1;
+
+    strbuf_reset(src);
+    while (src->len < bytes) {
+        k = k * 1103515245 + 12345;
+        strbuf_addf(src, "%s", lines[(k >> 16) % (a1 ? 6 : 4)]);
+    }
+    strbuf_reserve(src, 2);
+    src->data[src->len] = src->data[src->len + 1] = '\0';
+}
+
+/* Milliseconds for the best of three parses, or -1 on a syntax error */
+static double timed(struct parser *p, struct strbuf *src) {
+    double best = -1;
+
+    for (int i = 0; i < 3; i++) {
+        double t = now();
+        if (parser_parse_buffer(p, src->data, src->len) != 0)
+            return -1;
+        t = (now() - t) * 1e3;
+        if (best < 0 || t < best)
+            best = t;
+    }
+    return best;
+}
+
+int main(int argc, char **argv) {
+    size_t mb = argc > 1 ? strtoul(argv[1], NULL, 10) : 64;
+    int a1 = argc > 2 && strcmp(argv[2], "a1") == 0;
+    struct parser *p = parser_new();
+    struct strbuf src = { 0 };
+
+    parser_set_dialect(p, a1 ? DIALECT_A1 : DIALECT_PE2);
+    printf("%6s %7s %10s %8s %8s\n", "MB", "batch", "parse (ms)", "MB/s",
+           "speedup");
+    for (size_t size = 1; size <= mb; size *= 4) {
+        double t_one = 0;
+
+        generate(&src, size << 20, a1);
+        for (int batch = 0; batch <= 4096; batch = batch ? 4 * batch : 64) {
+            double t;
+
+            p->token_batch = batch;
+            if ((t = timed(p, &src)) < 0) {
+                fprintf(stderr, "batch: the generated code did not parse\n");
+                return 1;
+            }
+            if (batch == 0)
+                t_one = t;
+            printf("%6zu %7d %10.1f %8.0f %7.2fx\n", size, batch, t,
+                   size * 1e3 / t, t_one / t);
+        }
+    }
+    strbuf_free(&src);
+    parser_free(p);
+    return 0;
+}
@@ -0,0 +1,68 @@
+#!/bin/sh
+#
+# corpus.sh - Mixed programs of both dialects, for training and timing
+#             the release build
+#
+# Usage: sh bench/corpus.sh DIR [scale] [seed]
+#
+# Writes DIR/pe2/*.c and DIR/a1/*.c: per dialect 400 × scale small
+# programs of 1 to 60 statements and 2 × scale large ones of about
+# 2 MB, every statement form of the dialect in a varying mix.  One file
+# in eight has a syntax error part-way through, so the diagnostic path
+# is exercised as well as the fast one.  The seed (default 1) changes
+# which forms, sizes and errors each file gets: make release trains on
+# one seed and bench/release.sh measures on another.
+
+DIR=$1
+SCALE=${2:-1}
+SEED=${3:-1}
+
+if [ -z "$DIR" ]; then
+    echo "usage: sh bench/corpus.sh DIR [scale] [seed]" >&2
+    exit 2
+fi
+mkdir -p "$DIR/pe2" "$DIR/a1"
+
+for dialect in pe2 a1; do
+    awk -v dialect="$dialect" -v dir="$DIR/$dialect" -v scale="$SCALE" \
+        -v seed="$SEED" '
+    function stmt(k) {
+        k = int(rand() * (dialect == "a1" ? 12 : 7))
+        if (k == 0) return "a = a + " int(rand() * 100) ";"
+        if (k == 1) return "b = (a * 2 - c) / 4 % 5 + x;"
+        if (k == 2) return "x = 3.25 * y - 0.5;"
+        if (k == 3) return "if (a >= b) { b = a; } else if (a != 0) b = 0;"
+        if (k == 4) return "do { a = a - 1; } while (a > 0);"
+        if (k == 5) return "// comment " int(rand() * 1000)
+        if (k == 6) return "{ int t; t = a; a = b; b = t; } /* swap */"
+        if (k == 7) return "while (a > 0 && b <= 10 || a == b) a--;"
+        if (k == 8) return "for (i = 0; i < 8; i++) { s += m[i][1 + 2]; }"
+        if (k == 9) return "switch (a) { case 1: b--; break; default: b -= 2; }"
+        if (k == 10) return "c = !(a < b) || m[7][3] == 0;"
+        return "i = m[i + 1][2 * 3 - 1] - -a;"
+    }
+    function bad(    k) {
+        k = int(rand() * 5)
+        if (k == 0) return "int p q;"
+        if (k == 1) return "a = (b + ;"
+        if (k == 2) return "if a > b) a = 1;"
+        if (k == 3) return "do { a = 1; } while (a > 0)"
+        return "b = 3 4;"
+    }
+    function program(f, n,    j, err) {
+        err = rand() < 0.125 ? int(rand() * n) : -1
+        if (dialect == "a1")
+            print "int m[8][4], i, s;" > f
+        print "int a, b, c;\nfloat x, y;" > f
+        for (j = 0; j < n; j++)
+            print (j == err ? bad() : stmt()) > f
+        close(f)
+    }
+    BEGIN {
+        srand(seed)
+        for (i = 0; i < 400 * scale; i++)
+            program(sprintf("%s/s%05d.c", dir, i), 1 + int(rand() * 60))
+        for (i = 0; i < 2 * scale; i++)
+            program(sprintf("%s/l%05d.c", dir, i), 50000)
+    }'
+done
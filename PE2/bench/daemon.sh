@@ -0,0 +1,40 @@
+#!/bin/sh
+#
+# daemon.sh - Small-file latency: c_parserd round trip vs. fork+exec
+#
+# Usage: sh bench/daemon.sh ./c_parser ./c_parserd
+#
+# Starts c_parserd on a private socket and runs bench/daemon_latency
+# against test_valid.c, test_invalid.c and a one-line program, then
+# times the same files through one c_parser process each for comparison.
+
+PARSER=${1:-./c_parser}
+DAEMON=${2:-./c_parserd}
+TMP=${TMPDIR:-/tmp}/daemon.$$
+SOCK=$TMP.sock
+trap 'kill $PID 2>/dev/null; rm -f "$TMP" "$SOCK"' EXIT INT TERM
+
+echo "int x; x = 1;" > "$TMP"
+
+"$DAEMON" "$SOCK" &
+PID=$!
+while [ ! -S "$SOCK" ]; do sleep 0.01; done
+
+echo "c_parserd round trip:"
+for f in "$TMP" test_valid.c test_invalid.c; do
+    bench/daemon_latency "$SOCK" "$f" 10000
+done
+
+echo "c_parser, one process per file (mean of 200):"
+for f in "$TMP" test_valid.c test_invalid.c; do
+    start=$(date +%s%N)
+    i=0
+    while [ $i -lt 200 ]; do
+        "$PARSER" < "$f" > /dev/null 2>&1
+        i=$((i + 1))
+    done
+    end=$(date +%s%N)
+    awk -v f="$f" -v ns="$((end - start))" 'BEGIN {
+        printf "%-24s %6.1f us\n", f, ns / 200 / 1e3
+    }'
+done
@@ -0,0 +1,108 @@
+/*
+ * daemon_latency.c - Round-trip latency of c_parserd
+ *
+ *     ./daemon_latency SOCKET FILE [N]
+ *
+ * Sends FILE N times (default 10000) over one connection and prints
+ * the p50 / p99 / max round trip.  Compare with the cost of forking
+ * c_parser once per file.
+ */
+
+#include <arpa/inet.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+static int io_full(int fd, void *buf, size_t len, int writing) {
+    char *p = buf;
+    while (len > 0) {
+        ssize_t n = writing ? write(fd, p, len) : read(fd, p, len);
+        if (n <= 0)
+            return -1;
+        p   += n;
+        len -= (size_t) n;
+    }
+    return 0;
+}
+
+static int cmp_ns(const void *a, const void *b) {
+    long x = *(const long *) a, y = *(const long *) b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s SOCKET FILE [N]\n", argv[0]);
+        return 2;
+    }
+    long n = argc > 3 ? atol(argv[3]) : 10000;
+    if (n < 1)
+        n = 1;
+
+    FILE *f = fopen(argv[2], "rb");
+    if (!f) {
+        perror(argv[2]);
+        return 2;
+    }
+    /* Build the request frame once: length prefix + file contents */
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    rewind(f);
+    char *req = malloc(4 + size);
+    uint32_t len = htonl((uint32_t) size);
+    memcpy(req, &len, 4);
+    if (fread(req + 4, 1, size, f) != (size_t) size) {
+        perror(argv[2]);
+        return 2;
+    }
+    fclose(f);
+
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    strncpy(addr.sun_path, argv[1], sizeof addr.sun_path - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *) &addr, sizeof addr) < 0) {
+        perror(argv[1]);
+        return 2;
+    }
+
+    long *ns = malloc(n * sizeof *ns);
+    char *reply = NULL;
+    size_t reply_cap = 0;
+    int status = 0;
+
+    for (long i = 0; i < n; i++) {
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        if (io_full(fd, req, 4 + size, 1) < 0 ||
+            io_full(fd, &len, 4, 0) < 0) {
+            fprintf(stderr, "connection lost\n");
+            return 2;
+        }
+        len = ntohl(len);
+        if (len > reply_cap) {
+            reply_cap = len;
+            reply = realloc(reply, reply_cap);
+        }
+        if (io_full(fd, reply, len, 0) < 0) {
+            fprintf(stderr, "connection lost\n");
+            return 2;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        ns[i] = (t1.tv_sec - t0.tv_sec) * 1000000000L
+              + (t1.tv_nsec - t0.tv_nsec);
+        status = len ? reply[0] : 2;
+    }
+
+    qsort(ns, n, sizeof *ns, cmp_ns);
+    printf("%-24s %8ld bytes  status %d  n=%ld  "
+           "p50 %6.1f us  p99 %6.1f us  max %6.1f us\n",
+           argv[2], size, status, n,
+           ns[n / 2] / 1e3, ns[n * 99 / 100] / 1e3, ns[n - 1] / 1e3);
+    close(fd);
+    return 0;
+}
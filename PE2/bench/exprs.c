@@ -0,0 +1,137 @@
+/*
+ * exprs.c - Counting parse events vs. hash-consing their expressions
+ *
+ *     ./bench/exprs [MB] [pe2|a1]
+ *
+ * Generates code of 1, 4, ... up to MB (default 64) megabytes and
+ * parses it with a visitor that only counts the events, then with one
+ * that also feeds an expr_store (see exprs.h).  Prints the expressions
+ * reported, the distinct ones kept, the dedup ratio and what the store
+ * costs.  The store is kept across the sizes, so its IDs must not
+ * change: an expression seen in a smaller run must get the same ID in
+ * every larger one.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../events.h"
+#include "../exprs.h"
+#include "../parser.h"
+#include "../strbuf.h"
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/* The same statements over and over, with a few names and constants
+   varied so that not everything is a repeat */
+static void generate(struct strbuf *src, size_t bytes, int a1) {
+    static const char *lines[] = {
+        "int a%u, b = %u, c;\n",
+        "if (a < b) { b = b * 2 - %u; } else { a = -a; }\n",
+        "x = 3.25 * y - (a + b%u) / 4;\n",
+        "do { a = a - 1; { b = b + a * %u; } } while (a > 0);\n",
+        "while (i < 10) { i += 2; x = a[i] && b || c%u; }\n",
+        "for (i = 0, j = 9; i < j; i++, j--) x = a[i][j] + %u;\n",
+    };
+    unsigned k = 1;
+
+    strbuf_reset(src);
+    while (src->len < bytes) {
+        k = k * 1103515245 + 12345;
+        strbuf_addf(src, lines[(k >> 16) % (a1 ? 6 : 4)], (k >> 8) % 64);
+    }
+    strbuf_reserve(src, 2);
+    src->data[src->len] = src->data[src->len + 1] = '\0';
+}
+
+struct run {
+    long               events;
+    struct expr_store *store;           /* or NULL to only count */
+    uint32_t          *ids;             /* the ID of each expression */
+    size_t             nids, cap;
+};
+
+static void count(void *ctx, const struct event *e) {
+    struct run *r = ctx;
+    uint32_t id;
+
+    r->events++;
+    if (!r->store || (id = exprs_add(r->store, e)) == EXPRS_NONE)
+        return;
+    if (r->nids == r->cap) {
+        r->cap = r->cap ? 2 * r->cap : 1024;
+        if (!(r->ids = realloc(r->ids, r->cap * sizeof *r->ids))) {
+            perror("exprs");
+            exit(1);
+        }
+    }
+    r->ids[r->nids++] = id;
+}
+
+/* Milliseconds for one parse, or -1 on a syntax error */
+static double timed(struct parser *p, struct strbuf *src, struct run *r) {
+    struct visitor v = { .exit = count, .ctx = r };
+    double t = now();
+    int result;
+
+    r->events = 0;
+    r->nids   = 0;
+    p->visitor = &v;
+    result = parser_parse_buffer(p, src->data, src->len);
+    p->visitor = NULL;
+    return result == 0 ? (now() - t) * 1e3 : -1;
+}
+
+int main(int argc, char **argv) {
+    size_t mb = argc > 1 ? strtoul(argv[1], NULL, 10) : 64;
+    int a1 = argc > 2 && strcmp(argv[2], "a1") == 0;
+    struct parser *p = parser_new();
+    struct strbuf src = { 0 };
+    struct expr_store store = { 0 };
+    struct run plain = { 0 }, hashed = { .store = &store };
+    uint32_t *first = NULL;             /* the IDs of the first run */
+    size_t nfirst = 0;
+    int status = 0;
+
+    parser_set_dialect(p, a1 ? DIALECT_A1 : DIALECT_PE2);
+    printf("%6s %10s %10s %8s %10s %10s %8s\n", "MB", "exprs", "distinct",
+           "dedup", "count (ms)", "store (ms)", "cost");
+    for (size_t size = 1; size <= mb; size *= 4) {
+        double t_plain, t_hashed;
+
+        generate(&src, size << 20, a1);
+        t_plain  = timed(p, &src, &plain);
+        t_hashed = timed(p, &src, &hashed);
+        if (t_plain < 0 || t_hashed < 0) {
+            fprintf(stderr, "exprs: the generated code did not parse\n");
+            return 1;
+        }
+
+        printf("%6zu %10zu %10u %8.2f %10.1f %10.1f %7.2fx\n", size,
+               hashed.nids, store.count, (double) hashed.nids / store.count,
+               t_plain, t_hashed, t_hashed / t_plain);
+
+        /* each size's code begins with the last one's */
+        if (!first) {
+            first  = hashed.ids;
+            nfirst = hashed.nids;
+            hashed.ids = NULL;
+            hashed.nids = hashed.cap = 0;
+        } else if (memcmp(first, hashed.ids, nfirst * sizeof *first) != 0) {
+            fprintf(stderr, "exprs: IDs changed between runs\n");
+            status = 1;
+        }
+    }
+    free(first);
+    free(hashed.ids);
+    exprs_free(&store);
+    strbuf_free(&src);
+    parser_free(p);
+    return status;
+}
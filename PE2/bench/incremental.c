@@ -0,0 +1,98 @@
+/*
+ * incremental.c - Cost of an edit against file size
+ *
+ *     ./bench/incremental
+ *
+ * Builds documents of 10^3 .. 10^6 top-level statements, then types and
+ * deletes a character in a statement in the middle, 1000 times each,
+ * through document_edit().  The time per edit should stay flat while
+ * the full parse grows with the file.  Then the same through
+ * document_apply() with BATCH edits spread over the whole file at once;
+ * the bytes reparsed per batch should not grow with the file either,
+ * though the gaps now travel across the whole file (a memmove).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../document.h"
+
+#define EDITS 1000
+#define BATCH 16
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static void generate(struct strbuf *src, long n) {
+    static const char *stmts[] = {
+        "int a%ld, b%ld;\n",
+        "a%ld = b%ld * 2 + 1;\n",
+        "if (a%ld > b%ld) { a%ld = a%ld - 1; } else b%ld = 0;\n",
+        "do { b%ld = b%ld + 1; } while (b%ld < 10);\n",
+    };
+
+    strbuf_reset(src);
+    for (long i = 0; i < n; i++)
+        strbuf_addf(src, stmts[i % 4], i, i, i, i, i);
+}
+
+int main(void) {
+    struct parser *p = parser_new();
+    struct strbuf src = { 0 };
+
+    printf("%10s %12s %12s %12s %12s %12s %10s\n", "stmts", "bytes",
+           "full (ms)", "edit (us)", "batch (us)", "reparsed", "verdict");
+    for (long n = 1000; n <= 1000000; n *= 10) {
+        struct document d = { 0 };
+        struct doc_edit type[BATCH], undo[BATCH];
+        double t0, t1, t2, full, edit;
+
+        generate(&src, n);
+        t0 = now();
+        document_set(&d, p, src.data, src.len);
+        t1 = now();
+        full = t1 - t0;
+
+        /* Type 'x' after the first character of the middle statement,
+           then delete it again.  The first edit moves the gaps from the
+           end of the file to the middle once; it is not timed. */
+        size_t at = document_segment(&d, d.nsegs / 2).start + 1;
+        document_edit(&d, p, at, at, "x", 1);
+        document_edit(&d, p, at, at + 1, "", 0);
+        t1 = now();
+        for (int i = 0; i < EDITS; i++) {
+            document_edit(&d, p, at, at, "x", 1);
+            document_edit(&d, p, at, at + 1, "", 0);
+        }
+        t2 = now();
+        edit = (t2 - t1) / (2 * EDITS);
+
+        /* A character typed into BATCH statements across the file, then
+           all of them deleted again */
+        for (int i = 0; i < BATCH; i++) {
+            size_t off = document_segment(&d, d.nsegs / BATCH * i).start + 1;
+            type[i] = (struct doc_edit) { off, off, "x", 1 };
+            undo[i] = (struct doc_edit) { off + i, off + i + 1, "", 0 };
+        }
+        t1 = now();
+        for (int i = 0; i < EDITS / 10; i++) {
+            document_apply(&d, p, type, BATCH);
+            document_apply(&d, p, undo, BATCH);
+        }
+        t2 = now();
+
+        printf("%10ld %12zu %12.3f %12.2f %12.2f %12zu %10s\n",
+               n, src.len, full * 1e3, edit * 1e6,
+               (t2 - t1) / (2 * EDITS / 10) * 1e6, d.reparsed,
+               d.nerrs ? "errors" : "valid");
+        document_free(&d);
+    }
+    parser_free(p);
+    strbuf_free(&src);
+    return 0;
+}
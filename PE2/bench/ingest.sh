@@ -0,0 +1,58 @@
+#!/bin/sh
+#
+# ingest.sh - Many small files: stdin per process vs. batched reads
+#
+# Usage: sh bench/ingest.sh ./c_parser [files]
+#
+# Writes the given number of small programs (default 20000) to a
+# scratch directory, then times:
+#   - the stdin path, one c_parser process per file (first 1000 files),
+#   - one c_parser over every file with open/read/close (--no-uring),
+#   - one c_parser over every file with io_uring batches.
+# Times are per file.  The files are read once beforehand, so all three
+# runs find them in the page cache.
+
+PARSER=${1:-./c_parser}
+N=${2:-20000}
+DIR=${TMPDIR:-/tmp}/ingest.$$
+trap 'rm -rf "$DIR"' EXIT INT TERM
+
+mkdir -p "$DIR"
+awk -v n="$N" -v dir="$DIR" 'BEGIN {
+    for (i = 0; i < n; i++) {
+        f = sprintf("%s/f%05d.c", dir, i)
+        printf "int a, b;\na = %d;\nif (a > 0) { b = a * 2; } else b = 0;\n", i > f
+        printf "do { a = a - 1; } while (a > 0);\n" > f
+        close(f)
+    }
+}'
+cat "$DIR"/*.c > /dev/null
+
+now_ns() {
+    date +%s%N
+}
+
+per_file() {    # label, files, start, end
+    awk -v l="$1" -v n="$2" -v ns="$(($4 - $3))" \
+        'BEGIN { printf "%-32s %8.2f us/file\n", l, ns / n / 1e3 }'
+}
+
+M=$((N < 1000 ? N : 1000))
+start=$(now_ns)
+for f in $(ls "$DIR"/*.c | head -n "$M"); do
+    "$PARSER" < "$f" > /dev/null
+done
+end=$(now_ns)
+per_file "stdin, one process per file" "$M" "$start" "$end"
+
+start=$(now_ns)
+"$PARSER" --no-uring "$DIR"/*.c > /dev/null
+end=$(now_ns)
+per_file "one process, open/read/close" "$N" "$start" "$end"
+
+start=$(now_ns)
+"$PARSER" "$DIR"/*.c > /dev/null
+end=$(now_ns)
+per_file "one process, io_uring" "$N" "$start" "$end"
+
+"$PARSER" --stats "$DIR"/*.c 2>&1 > /dev/null | grep "Input files"
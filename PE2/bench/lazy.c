@@ -0,0 +1,165 @@
+/*
+ * lazy.c - Top-level declarations with and without lazy_blocks
+ *
+ *     ./bench/lazy [pe2|a1]
+ *
+ * Generates files of 10^3 .. 10^5 top-level declarations, each followed
+ * by a loop or if whose block body holds BODY statements (nested
+ * blocks, comments with braces in them), and finds the top-level
+ * declarations three ways, through a visitor (events.h):
+ *
+ *   full       parse everything
+ *   lazy       lazy_blocks: each body skipped by brace matching
+ *   on demand  lazy, then every skipped body through parser_parse_body(),
+ *              and theirs in turn
+ *
+ * The last must see exactly the events of the first, kind by kind.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../events.h"
+#include "../strbuf.h"
+
+#define BODY 40
+
+struct query {
+    long         counts[EVENT_KINDS];
+    long         top_decls;     /* declarations outside any statement */
+    int          depth;         /* statements open                    */
+    struct span *bodies;        /* skipped, still to parse            */
+    size_t       nbodies, cap;
+};
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static int statement(enum event_kind k) {
+    return k <= EVENT_BREAK;
+}
+
+static void enter(void *ctx, const struct event *e) {
+    struct query *q = ctx;
+    q->depth += statement(e->kind);
+}
+
+static void leave(void *ctx, const struct event *e) {
+    struct query *q = ctx;
+
+    q->counts[e->kind]++;
+    q->depth -= statement(e->kind);
+    if (e->kind == EVENT_DECL && q->depth == 0)
+        q->top_decls++;
+    if (e->kind == EVENT_BLOCK && e->skipped) {
+        if (q->nbodies == q->cap) {
+            q->cap = q->cap ? 2 * q->cap : 1024;
+            q->bodies = realloc(q->bodies, q->cap * sizeof *q->bodies);
+            if (!q->bodies) {
+                perror("lazy");
+                exit(1);
+            }
+        }
+        q->bodies[q->nbodies++] = e->body;
+    }
+}
+
+static void generate(struct strbuf *src, long n, int a1) {
+    static const char *body[] = {
+        "a = a + 1; // {\n",
+        "if (a < b) { b = b * 2 - 1; } else { a = -a; }\n",
+        "x = 3.25 * y - (a + b) / 4; /* } } */\n",
+        "do { a = a - 1; { b = b + a; } } while (a > 0);\n",
+    };
+
+    strbuf_reset(src);
+    for (long i = 0; i < n; i++) {
+        strbuf_addf(src, "int g%ld, h%ld = %ld;\n", i, i, i);
+        if (a1)
+            strbuf_addf(src, i % 2 ? "while (g%ld < 10) {\n"
+                                   : "for (g%ld = 0; g%ld < 9; g%ld++) {\n",
+                        i, i, i);
+        else
+            strbuf_addf(src, i % 2 ? "if (g%ld > 0) {\n" : "do {\n", i);
+        for (int j = 0; j < BODY; j++)
+            strbuf_addf(src, "    %s", body[(i + j) % 4]);
+        strbuf_addf(src, a1 || i % 2 ? "}\n" : "} while (g%ld);\n", i);
+    }
+}
+
+/* Parse src with p's settings; -1 on a syntax error */
+static double timed(struct parser *p, struct strbuf *src, struct query *q) {
+    double t = now();
+
+    memset(q->counts, 0, sizeof q->counts);
+    q->top_decls = 0;
+    q->depth = 0;
+    q->nbodies = 0;
+    if (parser_parse_buffer(p, src->data, src->len) != 0)
+        return -1;
+    return now() - t;
+}
+
+int main(int argc, char **argv) {
+    struct parser *p = parser_new();
+    struct strbuf src = { 0 };
+    struct query full = { 0 }, lazy = { 0 };
+    struct visitor v = { enter, leave, NULL };
+    int a1 = argc > 1 && strcmp(argv[1], "a1") == 0;
+
+    parser_set_dialect(p, a1 ? DIALECT_A1 : DIALECT_PE2);
+    p->visitor = &v;
+    printf("%8s %10s %10s %10s %8s %12s %s\n", "decls", "bytes",
+           "full (ms)", "lazy (ms)", "speedup", "demand (ms)", "events");
+    for (long n = 1000; n <= 100000; n *= 10) {
+        double t_full, t_lazy, t_demand;
+
+        generate(&src, n, a1);
+        strbuf_reserve(&src, 2);
+        src.data[src.len] = src.data[src.len + 1] = '\0';
+
+        v.ctx = &full;
+        p->lazy_blocks = 0;
+        t_full = timed(p, &src, &full);
+
+        v.ctx = &lazy;
+        p->lazy_blocks = 1;
+        t_lazy = timed(p, &src, &lazy);
+        if (t_full < 0 || t_lazy < 0 || lazy.top_decls != n ||
+            full.top_decls != n) {
+            fprintf(stderr, "lazy: the generated file did not parse\n");
+            return 1;
+        }
+
+        /* every body, breadth first: each adds its own blocks' */
+        double t = now();
+        for (size_t i = 0; i < lazy.nbodies; i++)
+            if (parser_parse_body(p, src.data, src.len,
+                                  lazy.bodies[i]) != 0) {
+                fprintf(stderr, "lazy: a body did not parse\n");
+                return 1;
+            }
+        t_demand = t_lazy + now() - t;
+
+        /* a skipped block was reported by its parent's parse */
+        int same = 1;
+        for (int k = 0; k < EVENT_KINDS; k++)
+            same &= lazy.counts[k] == full.counts[k];
+
+        printf("%8ld %10zu %10.2f %10.2f %7.1fx %12.2f %s\n", n, src.len,
+               t_full * 1e3, t_lazy * 1e3, t_full / t_lazy, t_demand * 1e3,
+               same ? "same" : "DIFFERENT");
+        if (!same)
+            return 1;
+    }
+    free(full.bodies);
+    free(lazy.bodies);
+    strbuf_free(&src);
+    parser_free(p);
+    return 0;
+}
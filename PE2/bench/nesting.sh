@@ -0,0 +1,45 @@
+#!/bin/sh
+#
+# nesting.sh - Parse time against nesting depth
+#
+# Usage: sh bench/nesting.sh ./c_parser
+#
+# Generates nested blocks  { { { ... } } }  and if-chains
+# if (a) if (a) ... a = 1;  at depths 10^3 .. 10^6 and times one parse
+# of each with the stack limit lifted.  Time per level should stay flat:
+# the parser stacks grow geometrically in one reusable arena.
+
+PARSER=${1:-./c_parser}
+TMP=${TMPDIR:-/tmp}/nesting.$$
+trap 'rm -f "$TMP"' EXIT INT TERM
+
+now_ns() {
+    date +%s%N
+}
+
+gen() {
+    awk -v shape="$1" -v n="$2" 'BEGIN {
+        if (shape == "block") {
+            for (i = 0; i < n; i++) printf "{";
+            for (i = 0; i < n; i++) printf "}";
+        } else {
+            for (i = 0; i < n; i++) printf "if (a) ";
+            printf "a = 1;";
+        }
+        printf "\n";
+    }' > "$TMP"
+}
+
+printf "%-8s %10s %12s %12s  %s\n" shape depth seconds ns/level verdict
+for shape in block if; do
+    for depth in 1000 10000 100000 1000000; do
+        gen "$shape" "$depth"
+        start=$(now_ns)
+        verdict=$("$PARSER" --max-depth=0 < "$TMP" 2>&1)
+        end=$(now_ns)
+        ns=$((end - start))
+        awk -v s="$shape" -v d="$depth" -v ns="$ns" -v v="$verdict" 'BEGIN {
+            printf "%-8s %10d %12.6f %12.1f  %s\n", s, d, ns / 1e9, ns / d, v
+        }'
+    done
+done
@@ -0,0 +1,54 @@
+#!/bin/sh
+#
+# parallel.sh - Skewed file sizes: c_parser -j N against -j 1
+#
+# Usage: sh bench/parallel.sh ./c_parser [small-files] [max-jobs]
+#
+# Writes one large program (about 33 MB, split into statement chunks
+# by -j) and the given number of small ones (default 2000) to a scratch
+# directory, then times c_parser over all of them for -j 1, 2, 4, ...
+# up to max-jobs (default: the number of CPUs), and prints the
+# per-worker utilization of the widest run.
+
+PARSER=${1:-./c_parser}
+N=${2:-2000}
+DIR=${TMPDIR:-/tmp}/parallel.$$
+CPUS=${3:-$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1)}
+trap 'rm -rf "$DIR"' EXIT INT TERM
+
+mkdir -p "$DIR"
+awk -v n="$N" -v dir="$DIR" 'BEGIN {
+    stmt = "a = a + 1;\nif (a > 0) { b = a * 2; } else b = 0;\n" \
+           "do { a = a - 1; } while (a > 0);\n"
+    f = dir "/huge.c"
+    print "int a, b;" > f
+    for (i = 0; i < 400000; i++)
+        printf "%s", stmt > f
+    close(f)
+    for (i = 0; i < n; i++) {
+        f = sprintf("%s/f%05d.c", dir, i)
+        print "int a, b;" > f
+        for (j = 0; j < 1 + i % 50; j++)
+            printf "%s", stmt > f
+        close(f)
+    }
+}'
+cat "$DIR"/*.c > /dev/null
+
+now_ns() {
+    date +%s%N
+}
+
+j=1
+while :; do
+    start=$(now_ns)
+    "$PARSER" -j "$j" "$DIR"/*.c > /dev/null
+    end=$(now_ns)
+    awk -v j="$j" -v ns="$((end - start))" \
+        'BEGIN { printf "-j %-3d %10.1f ms\n", j, ns / 1e6 }'
+    [ "$j" -ge "$CPUS" ] && break
+    j=$((j * 2 > CPUS ? CPUS : j * 2))
+done
+
+"$PARSER" --stats -j "$j" "$DIR"/*.c 2>&1 > /dev/null |
+    sed -n '/^Workers/,/^$/p'
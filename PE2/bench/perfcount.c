@@ -0,0 +1,148 @@
+/*
+ * perfcount.c - Wall time and hardware counters of one command
+ *
+ *     ./perfcount [-o FILE] COMMAND [ARG...]
+ *
+ * Runs COMMAND (threads included) with perf_event_open() counters on
+ * it from exec to exit, and prints one "name value" line per counter
+ * to FILE (default stderr), after the command's own output:
+ *
+ *     ns                       wall time
+ *     instructions             user space only, like every counter
+ *     cycles
+ *     L1-dcache-load-misses
+ *     L1-icache-load-misses
+ *
+ * A counter the kernel or the CPU will not give us (a VM, a container,
+ * perf_event_paranoid > 2) reads "n/a".  Counts are scaled when the
+ * kernel had to multiplex them.  Exit status is the command's.
+ */
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CACHE(cache, op, result) \
+    ((PERF_COUNT_HW_CACHE_##cache) | (PERF_COUNT_HW_CACHE_OP_##op << 8) | \
+     (PERF_COUNT_HW_CACHE_RESULT_##result << 16))
+
+static const struct counter {
+    const char *name;
+    uint32_t    type;
+    uint64_t    config;
+} counters[] = {
+    { "instructions",          PERF_TYPE_HARDWARE,
+      PERF_COUNT_HW_INSTRUCTIONS },
+    { "cycles",                PERF_TYPE_HARDWARE,
+      PERF_COUNT_HW_CPU_CYCLES },
+    { "L1-dcache-load-misses", PERF_TYPE_HW_CACHE,
+      CACHE(L1D, READ, MISS) },
+    { "L1-icache-load-misses", PERF_TYPE_HW_CACHE,
+      CACHE(L1I, READ, MISS) },
+};
+
+#define NCOUNTERS (sizeof counters / sizeof counters[0])
+
+static int open_counter(const struct counter *c, pid_t pid) {
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof attr);
+    attr.size           = sizeof attr;
+    attr.type           = c->type;
+    attr.config         = c->config;
+    attr.disabled       = 1;
+    attr.enable_on_exec = 1;     /* not the fork, not our exec() call */
+    attr.inherit        = 1;     /* -j worker threads */
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED |
+                          PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int) syscall(SYS_perf_event_open, &attr, pid, -1, -1, 0);
+}
+
+static long long now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+    FILE *out = stderr;
+    int fds[NCOUNTERS], go[2], status;
+    long long start, end;
+    pid_t pid;
+    int argi = 1;
+
+    if (argc > 2 && strcmp(argv[1], "-o") == 0) {
+        if (!(out = fopen(argv[2], "w"))) {
+            perror(argv[2]);
+            return 2;
+        }
+        argi = 3;
+    }
+    if (argi >= argc) {
+        fprintf(stderr, "usage: %s [-o FILE] COMMAND [ARG...]\n", argv[0]);
+        return 2;
+    }
+
+    /* The child waits on the pipe until its counters are open */
+    if (pipe(go) != 0 || (pid = fork()) < 0) {
+        perror("perfcount");
+        return 2;
+    }
+    if (pid == 0) {
+        char c;
+
+        close(go[1]);
+        if (read(go[0], &c, 1) != 1)
+            _exit(127);
+        close(go[0]);
+        execvp(argv[argi], argv + argi);
+        perror(argv[argi]);
+        _exit(127);
+    }
+    close(go[0]);
+    for (size_t i = 0; i < NCOUNTERS; i++)
+        fds[i] = open_counter(&counters[i], pid);
+
+    start = now_ns();
+    if (write(go[1], "", 1) != 1) {
+        perror("perfcount");
+        return 2;
+    }
+    close(go[1]);
+    while (waitpid(pid, &status, 0) < 0)
+        if (errno != EINTR) {
+            perror("waitpid");
+            return 2;
+        }
+    end = now_ns();
+
+    fprintf(out, "%-22s %lld\n", "ns", end - start);
+    for (size_t i = 0; i < NCOUNTERS; i++) {
+        uint64_t v[3];  /* value, time enabled, time running */
+
+        if (fds[i] < 0 || read(fds[i], v, sizeof v) != sizeof v ||
+            v[2] == 0) {
+            fprintf(out, "%-22s n/a\n", counters[i].name);
+            continue;
+        }
+        if (v[2] < v[1])
+            v[0] = (uint64_t) ((double) v[0] * v[1] / v[2]);
+        fprintf(out, "%-22s %llu\n", counters[i].name,
+                (unsigned long long) v[0]);
+        close(fds[i]);
+    }
+    if (out != stderr)
+        fclose(out);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
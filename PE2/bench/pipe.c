@@ -0,0 +1,118 @@
+/*
+ * pipe.c - One thread scanning and parsing, or a scanner thread ahead
+ *
+ *     ./bench/pipe [MB] [pe2|a1]
+ *
+ * Generates code of 64 KB, 256 KB, ... up to MB (default 64) megabytes
+ * and parses it on one thread (the parser calls the scanner for each
+ * token) and then with lex_pipe set for it (a second thread scans a
+ * batch at a time into a ring the parser empties; see tokens.h).  The
+ * last column marks the sizes the default threshold (TOKENS_PIPE_MIN)
+ * pipes.  Both must find the code valid, and the same code with an
+ * error near the end must give the same diagnostics both ways.
+ */
+
+#define _GNU_SOURCE             /* memrchr */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../parser.h"
+#include "../strbuf.h"
+#include "../tokens.h"
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static void generate(struct strbuf *src, size_t bytes, int a1) {
+    static const char *lines[] = {
+        "int a, b = 12, c;\n",
+        "if (a < b) { b = b * 2 - 1; } else { a = -a; } // a /* b\n",
+        "/* a comment\n   over lines */ x = 3.25 * y - (a + b) / 4;\n",
+        "do { a = a - 1; { b = b + a; } } while (a > 0);\n",
+        "while (i < 10) { i += 2; x = a[i] && b || c; }\n",
+        "for (i = 0, j = 9; i < j; i++, j--) x = a[i][j];\n",
+    };
+    unsigned k = 1;
+
+    strbuf_reset(src);
+    while (src->len < bytes) {
+        k = k * 1103515245 + 12345;
+        strbuf_addf(src, "%s", lines[(k >> 16) % (a1 ? 6 : 4)]);
+    }
+    strbuf_reserve(src, 2);
+    src->data[src->len] = src->data[src->len + 1] = '\0';
+}
+
+/* Milliseconds for the best of three parses, or -1 on a syntax error */
+static double timed(struct parser *p, struct strbuf *src) {
+    double best = -1;
+
+    for (int i = 0; i < 3; i++) {
+        double t = now();
+        if (parser_parse_buffer(p, src->data, src->len) != 0)
+            return -1;
+        t = (now() - t) * 1e3;
+        if (best < 0 || t < best)
+            best = t;
+    }
+    return best;
+}
+
+/* The diagnostics for src with its last statement broken */
+static void broken(struct parser *p, struct strbuf *src, struct strbuf *out) {
+    char *semi = memrchr(src->data, ';', src->len);
+    char c = *semi;
+
+    *semi = '@';
+    parser_parse_buffer(p, src->data, src->len);
+    *semi = c;
+    strbuf_reset(out);
+    strbuf_add(out, p->diag.data, p->diag.len);
+}
+
+int main(int argc, char **argv) {
+    size_t mb = argc > 1 ? strtoul(argv[1], NULL, 10) : 64;
+    int a1 = argc > 2 && strcmp(argv[2], "a1") == 0;
+    struct parser *p = parser_new();
+    struct strbuf src = { 0 }, one = { 0 }, two = { 0 };
+    int status = 0;
+
+    parser_set_dialect(p, a1 ? DIALECT_A1 : DIALECT_PE2);
+    printf("%8s %10s %8s %10s %8s %8s %s\n", "KB", "one (ms)", "MB/s",
+           "pipe (ms)", "MB/s", "speedup", "diags");
+    for (size_t kb = 64; kb <= mb << 10; kb *= 4) {
+        double t_one, t_pipe;
+
+        generate(&src, kb << 10, a1);
+        p->lex_pipe = 0;
+        t_one = timed(p, &src);
+        broken(p, &src, &one);
+        p->lex_pipe = 1;
+        t_pipe = timed(p, &src);
+        broken(p, &src, &two);
+        if (t_one < 0 || t_pipe < 0) {
+            fprintf(stderr, "pipe: the generated code did not parse\n");
+            return 1;
+        }
+
+        int same = one.len == two.len &&
+                   memcmp(one.data, two.data, one.len) == 0;
+        printf("%8zu %10.2f %8.0f %10.2f %8.0f %7.2fx %s%s\n", kb, t_one,
+               kb / 1.024 / t_one, t_pipe, kb / 1.024 / t_pipe,
+               t_one / t_pipe, same ? "same" : "DIFFERENT",
+               kb << 10 >= TOKENS_PIPE_MIN ? "  (piped)" : "");
+        if (!same)
+            status = 1;
+    }
+    strbuf_free(&src);
+    strbuf_free(&one);
+    strbuf_free(&two);
+    parser_free(p);
+    return status;
+}
@@ -0,0 +1,73 @@
+#!/bin/sh
+#
+# release.sh - The release build (make release) against the default one
+#
+# Usage: sh bench/release.sh ./c_parser ./release/c_parser
+#
+# Writes bench/corpus.sh's programs with a seed the release build was
+# not trained on, checks that both binaries print the same verdicts and
+# diagnostics and exit the same way on every workload, then times each
+# workload with each binary (best of three) and prints the speedup.
+# Exits 1 if any verdict differs.
+
+BASE=${1:-./c_parser}
+RELEASE=${2:-./release/c_parser}
+DIR=${TMPDIR:-/tmp}/release.$$
+trap 'rm -rf "$DIR"' EXIT INT TERM
+
+sh "$(dirname "$0")/corpus.sh" "$DIR" 2 7
+cat "$DIR"/*/*.c > /dev/null
+
+now_ns() {
+    date +%s%N
+}
+
+# run binary, workload args... > its stdout, stderr and exit status
+run() {
+    bin=$1
+    shift
+    "$bin" "$@" 2>&1
+    echo "exit $?"
+}
+
+best() {    # binary, workload args...
+    b=
+    for i in 1 2 3; do
+        start=$(now_ns)
+        "$@" > /dev/null 2>&1
+        end=$(now_ns)
+        ns=$((end - start))
+        [ -z "$b" ] || [ "$ns" -lt "$b" ] && b=$ns
+    done
+    echo "$b"
+}
+
+status=0
+workload() {    # label, args...
+    label=$1
+    shift
+    run "$BASE" "$@" > "$DIR/base.out"
+    run "$RELEASE" "$@" > "$DIR/release.out"
+    if cmp -s "$DIR/base.out" "$DIR/release.out"; then
+        same=same
+    else
+        same=DIFFERENT
+        status=1
+    fi
+    base=$(best "$BASE" "$@")
+    release=$(best "$RELEASE" "$@")
+    awk -v l="$label" -v b="$base" -v r="$release" -v s="$same" 'BEGIN {
+        printf "%-20s %10.1f %10.1f %7.2fx  %s\n", l, b / 1e6, r / 1e6,
+               b / r, s
+    }'
+}
+
+printf "%-20s %10s %10s %8s  %s\n" workload default-ms release-ms speedup \
+       verdicts
+workload "pe2"             "$DIR"/pe2/*.c
+workload "pe2 -j 4"        -j 4 "$DIR"/pe2/*.c
+workload "pe2 jsonl"       --format=jsonl "$DIR"/pe2/*.c
+workload "a1 lalr"         --dialect=a1 "$DIR"/a1/*.c
+workload "a1 rd"           --dialect=a1 --parser=rd "$DIR"/a1/*.c
+workload "a1 check-bounds" --dialect=a1 --check-bounds "$DIR"/a1/*.c
+exit $status
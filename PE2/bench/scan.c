@@ -0,0 +1,120 @@
+/*
+ * scan.c - Scanning one large file on 1 .. N threads (tokens.c)
+ *
+ *     ./bench/scan [MB] [threads]
+ *
+ * Generates PE2 code of 16, 64, ... up to MB (default 128) megabytes,
+ * with block comments across lines, comment markers inside comments
+ * and // comments holding a slash-star, then scans it with
+ * tokens_scan() on 1, 2, 4, ... threads (default: the CPUs online) and
+ * parses it with lex_threads set the same.  One thread is the plain
+ * sequential scan; every other token list must equal it token for
+ * token, and every parse must find the code valid.
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../grammar.h"
+#include "../parser.h"
+#include "../strbuf.h"
+#include "../tokens.h"
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static void generate(struct strbuf *src, size_t bytes) {
+    static const char *lines[] = {
+        "int a, b = 12, c;\n",
+        "if (a < b) { b = b * 2 - 1; } else { a = -a; } // a /* b\n",
+        "/* a comment\n   over lines, with a = b * c; in it / * /\n*/\n",
+        "x = 3.25 * y - (a + b) / 4; /* } */ y = x / 2;\n",
+        "do { a = a - 1; /** / **/ } while (a > 0);\n",
+        "/*\n * {\n */ float r;\n",
+    };
+    unsigned k = 1;
+
+    strbuf_reset(src);
+    while (src->len < bytes) {
+        k = k * 1103515245 + 12345;
+        strbuf_addf(src, "%s", lines[(k >> 16) % 6]);
+    }
+    strbuf_reserve(src, 2);
+    src->data[src->len] = src->data[src->len + 1] = '\0';
+}
+
+/* Only a literal (a token that starts with a digit) has a value */
+static int same(const struct token_buf *a, const struct token_buf *b) {
+    if (a->tail != b->tail)
+        return 0;
+    for (size_t i = 0; i < a->tail; i++)
+        if (a->kinds[i] != b->kinds[i] || a->offsets[i] != b->offsets[i] ||
+            a->lengths[i] != b->lengths[i] ||
+            (isdigit((unsigned char) a->buf[a->offsets[i]]) &&
+             memcmp(&a->values[i], &b->values[i], sizeof *a->values) != 0))
+            return 0;
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    size_t mb = argc > 1 ? strtoul(argv[1], NULL, 10) : 128;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int max = argc > 2 ? atoi(argv[2]) : cpus > 0 ? (int) cpus : 1;
+    struct token_buf seq = { 0 }, par = { 0 };
+    struct parser *p = parser_new();
+    struct strbuf src = { 0 };
+    int status = 0;
+
+    printf("%6s %7s %6s %10s %8s %8s %10s %s\n", "MB", "threads",
+           "chunks", "scan (ms)", "MB/s", "speedup", "parse (ms)",
+           "tokens");
+    for (size_t size = mb < 16 ? mb : 16; size <= mb; size = size < mb && 4 * size > mb
+                                                   ? mb : 4 * size) {
+        double t_seq = 0;
+
+        generate(&src, size << 20);
+        /* untimed: the lists' memory is touched for the first time */
+        tokens_scan(p->grammar, src.data, src.len, 1, &seq);
+        tokens_scan(p->grammar, src.data, src.len, max, &par);
+
+        for (int n = 1; ; n = 2 * n > max && n < max ? max : 2 * n) {
+            struct token_buf *t = n == 1 ? &seq : &par;
+            double t0 = now(), t_scan, t_parse;
+            int chunks, result;
+
+            chunks = tokens_scan(p->grammar, src.data, src.len, n, t);
+            t_scan = now() - t0;
+            if (n == 1)
+                t_seq = t_scan;
+
+            p->lex_threads = n;
+            t0 = now();
+            result = parser_parse_buffer(p, src.data, src.len);
+            t_parse = now() - t0;
+
+            int ok = n == 1 || same(&seq, &par);
+            printf("%6zu %7d %6d %10.1f %8.0f %7.2fx %10.1f %s%s\n", size,
+                   n, chunks, t_scan * 1e3, size / t_scan, t_seq / t_scan,
+                   t_parse * 1e3, ok ? "same" : "DIFFERENT",
+                   result == 0 ? "" : ", syntax error");
+            if (!ok || result != 0)
+                status = 1;
+            if (n >= max)
+                break;
+        }
+        if (size >= mb)
+            break;
+    }
+    tokens_free(&seq);
+    tokens_free(&par);
+    strbuf_free(&src);
+    parser_free(p);
+    return status;
+}
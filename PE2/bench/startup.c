@@ -0,0 +1,84 @@
+/*
+ * startup.c - Time to verdict on empty input
+ *
+ *     ./startup [-n N] COMMAND [ARG...]
+ *
+ * Runs COMMAND N times (default 2000) with stdin empty and stdout and
+ * stderr discarded, and prints the min / p50 / p99 time from spawn to
+ * exit.  There is nothing to parse, so this is what a process costs
+ * before its first token: exec, the dynamic loader (if any), libc and
+ * our own initialization.  posix_spawn() (vfork) keeps our own share
+ * of that small.
+ */
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+static long now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+static int cmp_ns(const void *a, const void *b) {
+    long x = *(const long *) a, y = *(const long *) b;
+    return (x > y) - (x < y);
+}
+
+extern char **environ;
+
+int main(int argc, char **argv) {
+    posix_spawn_file_actions_t quiet;
+    int n = 2000, argi = 1, status;
+    long *ns;
+
+    if (argc > 2 && strcmp(argv[1], "-n") == 0) {
+        n = atoi(argv[2]);
+        argi = 3;
+    }
+    if (argi >= argc || n < 1) {
+        fprintf(stderr, "usage: %s [-n N] COMMAND [ARG...]\n", argv[0]);
+        return 2;
+    }
+    if (!(ns = malloc(n * sizeof *ns))) {
+        perror("startup");
+        return 2;
+    }
+    posix_spawn_file_actions_init(&quiet);
+    posix_spawn_file_actions_addopen(&quiet, STDIN_FILENO, "/dev/null",
+                                     O_RDONLY, 0);
+    posix_spawn_file_actions_addopen(&quiet, STDOUT_FILENO, "/dev/null",
+                                     O_WRONLY, 0);
+    posix_spawn_file_actions_adddup2(&quiet, STDOUT_FILENO, STDERR_FILENO);
+
+    for (int i = 0; i < n; i++) {
+        long start = now_ns();
+        pid_t pid;
+
+        if (posix_spawnp(&pid, argv[argi], &quiet, NULL, argv + argi,
+                         environ) != 0 ||
+            waitpid(pid, &status, 0) < 0 || !WIFEXITED(status)) {
+            fprintf(stderr, "startup: %s did not run\n", argv[argi]);
+            return 2;
+        }
+        ns[i] = now_ns() - start;
+    }
+
+    /* the command line, as the label */
+    char label[64] = "";
+    for (int i = argi; i < argc; i++)
+        snprintf(label + strlen(label), sizeof label - strlen(label),
+                 "%s%s", i > argi ? " " : "", argv[i]);
+
+    qsort(ns, n, sizeof *ns, cmp_ns);
+    printf("%-28s min %7.1f us   p50 %7.1f us   p99 %7.1f us\n",
+           label, ns[0] / 1e3, ns[n / 2] / 1e3, ns[n * 99 / 100] / 1e3);
+    return 0;
+}
@@ -0,0 +1,35 @@
+#!/bin/sh
+#
+# stream.sh - --count over a long stream in a fixed amount of memory
+#
+# Usage: sh bench/stream.sh [c_parser] [MB]
+#
+# Pipes MB megabytes (default 2000) of statements into c_parser --count
+# with its address space limited to LIMIT_KB (default 32768): a parse
+# that kept the input, or anything per statement, would run out long
+# before the end.  Prints the counts, the verdict and the throughput.
+# The statements are one line repeated, cut at a line boundary, and the
+# same run without --count (the whole input in memory) is expected to
+# fail under the limit.
+
+PARSER=${1:-./c_parser}
+MB=${2:-2000}
+LIMIT_KB=${LIMIT_KB:-32768}
+LINE='if (a < b) { b = a * 2.5 - (c + 1); } else a = a + 1; // step'
+LEN=$((${#LINE} + 1))
+BYTES=$((MB * 1000000 / LEN * LEN))
+
+now_ns() { date +%s%N; }
+
+echo "$MB MB through $PARSER --count, address space <= $LIMIT_KB KB"
+start=$(now_ns)
+yes "$LINE" | head -c "$BYTES" |
+    (ulimit -v "$LIMIT_KB" && exec "$PARSER" --count) || exit 1
+ns=$(($(now_ns) - start))
+awk -v b="$BYTES" -v ns="$ns" \
+    'BEGIN { printf "%.1f s, %.1f MB/s\n", ns / 1e9, b / (ns / 1e3) }'
+
+echo "the same without --count:"
+yes "$LINE" | head -c "$BYTES" |
+    (ulimit -v "$LIMIT_KB" && exec "$PARSER" > /dev/null 2>&1)
+echo "exit status $? (the whole input does not fit)"
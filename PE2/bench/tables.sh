@@ -0,0 +1,142 @@
+#!/bin/sh
+#
+# tables.sh - flex table compression × Bison LR type, on one corpus
+#
+# Usage: sh bench/tables.sh [FILE...]
+#
+# Builds c_parser once per scanner table mode (flex -Cem, its default
+# and smallest, through -CF, full tables and the fastest lookup) and
+# parser construction (LALR, IELR), each in a scratch copy of this
+# directory, then runs every build over the same corpus: the given
+# files, or a generated mix of every statement form (about 30 MB).
+# For each build it prints
+#
+#   scanner, parser   bytes of the dialect's flex and Bison tables
+#   binary            text + data of c_parser
+#   MB/s              best of RUNS runs (default 5)
+#   L1d/KB, L1i/KB    L1 data / instruction read misses per KB of input
+#                     in that run (bench/perfcount; n/a without a PMU)
+#
+# and checks that it reports exactly what the first build did.
+#
+# DIALECT=a1 generates (or parses the files as) the a1 dialect.
+# SCANNERS and PARSERS narrow or widen the matrix, e.g.
+#     SCANNERS="-Cem -CF" PARSERS="ielr canonical-lr" sh bench/tables.sh
+
+SRC=$(cd "$(dirname "$0")/.." && pwd)
+PERFCOUNT=$SRC/bench/perfcount
+DIALECT=${DIALECT:-pe2}
+RUNS=${RUNS:-5}
+SCANNERS=${SCANNERS:--Cem -Ce -Cm -C -Cfe -Cf -CFe -CF}
+PARSERS=${PARSERS:-lalr ielr}
+DIR=${TMPDIR:-/tmp}/tables.$$
+trap 'rm -rf "$DIR"' EXIT INT TERM
+
+if [ ! -x "$PERFCOUNT" ]; then
+    echo "tables.sh: no $PERFCOUNT (make bench/perfcount)" >&2
+    exit 1
+fi
+mkdir -p "$DIR"
+
+if [ $# -eq 0 ]; then
+    awk -v dialect="$DIALECT" -v f="$DIR/mix.c" 'BEGIN {
+        if (dialect == "a1")
+            print "int m[10][4];" > f
+        print "int a, b, count_1;\nfloat x, y;\nchar c;\ndouble d;" > f
+        for (i = 0; i < 120000; i++) {
+            print "// statement group " i > f
+            print "a = a + 1; b = (a * 2 - 3) / 4 % 5;" > f
+            print "x = 3.25 * y + 0.5; count_1 = count_1 + a;" > f
+            print "if (a >= b) { b = a; }" > f
+            print "else if (a != 0) b = 0; else a = 1;" > f
+            print "/* block\n   comment */ do { a = a - 1; } while (a > 0);" > f
+            if (dialect == "a1") {
+                print "while (a > 0 && b <= 10 || a == b) a--;" > f
+                print "for (a = 0; a < 10; a++) { b += m[a][1 + 2]; }" > f
+                print "switch (a) { case 1: b--; break; default: " \
+                      "b -= 2; }" > f
+            }
+        }
+        close(f)
+    }'
+    set -- "$DIR/mix.c"
+fi
+BYTES=$(cat "$@" | wc -c)
+cat "$@" > /dev/null
+
+# Bytes of the tables flex and Bison emit (static arrays, so nm shows
+# them as local data), by object file
+table_bytes() {    # object, scanner|parser
+    nm -S --defined-only "$1" | awk -v want="$2" '
+        BEGIN {
+            re["scanner"] = "^yy_(accept|ec|meta|base|def|nxt|chk|" \
+                            "transition|start_state_list|NUL_trans)$"
+            re["parser"]  = "^yy(translate|pact|defact|pgoto|defgoto|" \
+                            "table|check|stos|r1|r2)$"
+        }
+        function hex(s,    i, n) {
+            n = 0
+            s = tolower(s)
+            for (i = 1; i <= length(s); i++)
+                n = n * 16 + index("0123456789abcdef", substr(s, i, 1)) - 1
+            return n
+        }
+        $4 ~ re[want] { n += hex($2) }
+        END { print n + 0 }'
+}
+
+build() {    # dir, flex flags, lr type
+    mkdir -p "$1"
+    cp -p "$SRC"/*.[chyl] "$SRC"/dialect.awk "$SRC"/Makefile "$1"
+    make -C "$1" clean > /dev/null
+    make -C "$1" c_parser CFLAGS="-O2" FLEXFLAGS="$2" \
+         BISONFLAGS="-Dlr.type=$3" > "$1/build.log" 2>&1 || {
+        echo "tables.sh: build $2 $3 failed:" >&2
+        cat "$1/build.log" >&2
+        return 1
+    }
+    (cd "$1" && gcc -O2 -c "lex_$DIALECT.c" "parser_$DIALECT.tab.c")
+}
+
+printf "%-18s %8s %8s %9s %8s %8s %8s\n" \
+       build scanner parser binary MB/s L1d/KB L1i/KB
+first=
+for lr in $PARSERS; do
+    for cf in $SCANNERS; do
+        name="$cf $lr"
+        b="$DIR/build$cf-$lr"
+        build "$b" "$cf" "$lr" || continue
+
+        best=
+        for run in $(seq "$RUNS"); do
+            "$PERFCOUNT" -o "$b/counts" "$b/c_parser" --dialect="$DIALECT" \
+                "$@" > "$b/out" 2>&1
+            ns=$(awk '$1 == "ns" { print $2 }' "$b/counts")
+            if [ -z "$best" ] || [ "$ns" -lt "$best" ]; then
+                best=$ns
+                cp "$b/counts" "$b/best"
+            fi
+        done
+        if [ -z "$first" ]; then
+            first=$b/out
+        elif ! cmp -s "$first" "$b/out"; then
+            name="$name !"
+        fi
+
+        awk -v name="$name" -v bytes="$BYTES" \
+            -v scanner="$(table_bytes "$b/lex_$DIALECT.o" scanner)" \
+            -v parser="$(table_bytes "$b/parser_$DIALECT.tab.o" parser)" \
+            -v binary="$(size "$b/c_parser" | awk 'NR == 2 { print $1 + $2 }')" '
+            { c[$1] = $2 }
+            function per_kb(v) {
+                return v == "n/a" ? v : sprintf("%.2f", v / (bytes / 1024))
+            }
+            END {
+                printf "%-18s %8d %8d %9d %8.1f %8s %8s\n", name,
+                       scanner, parser, binary, bytes / (c["ns"] / 1e9) / 1e6,
+                       per_kb(c["L1-dcache-load-misses"]),
+                       per_kb(c["L1-icache-load-misses"])
+            }' "$b/best"
+    done
+done
+echo "(! = output differs from the first build's)"
@@ -0,0 +1,31 @@
+#!/bin/sh
+#
+# train.sh - The training run of make release
+#
+# Usage: sh bench/train.sh ./c_parser-instrumented
+#
+# Runs an instrumented c_parser (-fprofile-generate) over
+# bench/corpus.sh's programs the way it is used: both dialects and both
+# a1 parsers, one thread and -j, text and JSON output, files and stdin.
+# Verdicts are not checked here; bench/release.sh does that.
+
+PARSER=${1:-./release/c_parser}
+DIR=${TMPDIR:-/tmp}/train.$$
+trap 'rm -rf "$DIR"' EXIT INT TERM
+
+sh "$(dirname "$0")/corpus.sh" "$DIR" 1 1
+
+run() {
+    "$PARSER" "$@" > /dev/null 2>&1
+}
+
+run "$DIR"/pe2/*.c
+run -j 4 "$DIR"/pe2/*.c
+run --format=jsonl "$DIR"/pe2/*.c
+run --dialect=a1 "$DIR"/a1/*.c
+run --dialect=a1 --parser=rd -j 4 "$DIR"/a1/*.c
+run --dialect=a1 --check-bounds --format=sarif "$DIR"/a1/*.c
+for f in "$DIR"/pe2/s0000*.c; do
+    run < "$f"
+done
+exit 0
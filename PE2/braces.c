@@ -0,0 +1,84 @@
+/*
+ * braces.c - Finding the '}' that closes a block (see braces.h)
+ */
+
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "braces.h"
+
+/* s[i] is a '/': the offset just past the comment it starts, or i + 1
+   if it starts none; BRACES_UNCLOSED_COMMENT if it is a block comment
+   that is not closed */
+static size_t comment(const char *s, size_t i, size_t len) {
+    if (i + 1 < len && s[i + 1] == '/') {
+        const char *nl = memchr(s + i + 2, '\n', len - i - 2);
+        return nl ? (size_t) (nl - s) + 1 : len;
+    }
+    if (i + 1 < len && s[i + 1] == '*') {
+        for (i += 2; i + 1 < len; i++) {
+            const char *star = memchr(s + i, '*', len - 1 - i);
+            if (!star)
+                break;
+            i = (size_t) (star - s);
+            if (s[i + 1] == '/')
+                return i + 2;
+        }
+        return BRACES_UNCLOSED_COMMENT;
+    }
+    return i + 1;
+}
+
+size_t braces_match(const char *s, size_t len) {
+    size_t i = 0;
+    long depth = 1;
+
+#ifdef __SSE2__
+    /* one mask per 16 bytes of where '{', '}' and '/' are */
+    const __m128i open = _mm_set1_epi8('{'), close = _mm_set1_epi8('}'),
+                  slash = _mm_set1_epi8('/');
+    while (i + 16 <= len) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (s + i));
+        unsigned mask = (unsigned) _mm_movemask_epi8(
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, open),
+                                      _mm_cmpeq_epi8(v, close)),
+                         _mm_cmpeq_epi8(v, slash)));
+        size_t next = i + 16;
+
+        while (mask) {
+            size_t at = i + (size_t) __builtin_ctz(mask);
+            mask &= mask - 1;
+            if (s[at] == '{') {
+                depth++;
+            } else if (s[at] == '}') {
+                if (--depth == 0)
+                    return at;
+            } else if ((next = comment(s, at, len)) != at + 1) {
+                if (next == BRACES_UNCLOSED_COMMENT)
+                    return next;
+                break;          /* go on after the comment */
+            } else {
+                next = i + 16;
+            }
+        }
+        i = next;
+    }
+#endif
+    while (i < len) {
+        if (s[i] == '{') {
+            depth++;
+        } else if (s[i] == '}') {
+            if (--depth == 0)
+                return i;
+        } else if (s[i] == '/') {
+            if ((i = comment(s, i, len)) == BRACES_UNCLOSED_COMMENT)
+                return i;
+            continue;
+        }
+        i++;
+    }
+    return len;
+}
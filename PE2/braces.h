@@ -0,0 +1,24 @@
+/*
+ * braces.h - Finding the '}' that closes a block, without parsing it
+ *
+ * A parser with lazy_blocks set (parser.h) skips the statements of each
+ * block: once the '{' is read the scanner jumps to the matching '}', and
+ * the body is parsed later only if someone asks for it.  The language
+ * has no strings or character constants, so only comments can hide a
+ * brace; the text is scanned 16 bytes at a time for '{', '}' and '/',
+ * and only those bytes are looked at one by one.
+ */
+
+#ifndef BRACES_H
+#define BRACES_H
+
+#include <stddef.h>
+
+/* braces_match(): a comment in the block runs to the end of the text */
+#define BRACES_UNCLOSED_COMMENT ((size_t) -1)
+
+/* s[0 .. len) follows a '{': the offset of the '}' that closes it, len
+   if it is not closed, or BRACES_UNCLOSED_COMMENT */
+size_t braces_match(const char *s, size_t len);
+
+#endif /* BRACES_H */
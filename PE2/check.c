@@ -0,0 +1,390 @@
+/*
+ * check.c - Checking the files named on the command line (see check.h)
+ *
+ * One job: the files are parsed in order by one parser while ingest.c
+ * reads ahead.  More: file sizes are skewed, so splitting the list
+ * statically would leave threads idle behind one huge file.  Instead
+ * every file is a task on a work-stealing scheduler (steal.c), dealt
+ * out largest first, and a file of SPLIT_BYTES or more is cut at
+ * top-level statement ends into chunks of about CHUNK_BYTES, which are
+ * tasks of their own.
+ *
+ * The chunk boundaries are found by a quick scan for ';' and '}' at
+ * brace and parenthesis depth 0 (a1's "for (;;)") outside comments.
+ * A program is a list of statements, so the file is valid if every
+ * chunk is.  If any chunk fails, say because a cut fell before an
+ * "else" the scan could not see, the file is parsed again whole, so the
+ * diagnostics are always those of a sequential parse.  With
+ * --check-bounds a subscript is checked against a declaration that may
+ * be in an earlier chunk, so files are not split.
+ *
+ * Workers never print: a finished file's diagnostics go into the
+ * worker's own buffer and its verdict onto a lock-free queue, and one
+ * printing thread streams verdicts out in command-line order (diag.c).
+ * The output is byte for byte that of -j 1.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "check.h"
+#include "diag.h"
+#include "format.h"
+#include "ingest.h"
+#include "steal.h"
+#include "strbuf.h"
+
+/* Files read ahead of the one being parsed (one job) */
+#define INGEST_DEPTH 64
+
+#define CHUNK_BYTES (1 << 20)
+#define SPLIT_BYTES (4 * CHUNK_BYTES)
+
+/* ================================================================
+   One job: in order, reading ahead
+   ================================================================ */
+
+static int check_in_order(struct parser *p, char **paths, int n, int uring,
+                          struct report *r) {
+    struct ingest *in = ingest_new((const char *const *) paths, n,
+                                   INGEST_DEPTH, uring);
+    struct diag_buf diags = { 0 };
+    struct ingest_file *f;
+    int status = 0;
+
+    p->diag_out = NULL;
+    while ((f = ingest_next(in)) != NULL) {
+        struct verdict v = { .file = f->index, .error = f->error };
+
+        if (f->error) {
+            v.status = 2;
+        } else if (parser_parse_buffer(p, f->data, f->len) != 0) {
+            v.status = 1;
+            v.diags  = diag_buf_add(&diags, f->index, p);
+            v.ndiags = p->errors;
+        }
+        report_verdict(r, f->path, &v);
+        if (v.status > status)
+            status = v.status;
+        diag_buf_reset(&diags);
+        ingest_release(in, f);
+    }
+    if (p->stats)
+        p->stats->io = ingest_uring(in) ? "io_uring" : "read";
+    diag_buf_free(&diags);
+    ingest_free(in);
+    return status;
+}
+
+/* ================================================================
+   Several jobs: work stealing
+   ================================================================ */
+
+enum { TASK_FILE, TASK_CHUNK };
+
+struct task {
+    int           kind;
+    struct file  *file;
+    size_t        start, end;   /* TASK_CHUNK: the bytes to parse   */
+    int           line;         /* ... and the line they start on   */
+};
+
+struct file {
+    const char   *path;
+    off_t         size;         /* at scheduling time, for ordering */
+    struct task   whole;        /* TASK_FILE                        */
+    struct strbuf text;         /* kept while chunks are parsed     */
+    struct task  *chunks;
+    atomic_int    left;         /* chunks not yet parsed            */
+    atomic_int    failed;       /* a chunk had an error             */
+    struct verdict verdict;     /* queued for printing when done    */
+};
+
+/* Each worker's own parser, input buffer, diagnostics and counters */
+struct job {
+    struct parser      *parser;
+    struct strbuf       chunk;  /* padded copy of the current chunk */
+    struct diag_buf     diags;
+    struct parse_stats  stats;
+};
+
+struct pool {
+    struct job           *jobs;
+    struct file          *files;
+    int                   nfiles;
+    struct verdict_queue  done;
+    struct report        *report;
+    int                   status;   /* of everything printed */
+};
+
+/* 1 if a statement may go on past this point: "else" or "while" next */
+static int continues(const char *s, size_t i, size_t len) {
+    while (i < len && (s[i] == ' ' || s[i] == '\t' || s[i] == '\r' ||
+                       s[i] == '\n'))
+        i++;
+    return (len - i >= 4 && memcmp(s + i, "else", 4) == 0) ||
+           (len - i >= 5 && memcmp(s + i, "while", 5) == 0);
+}
+
+/* Cut the text into chunks ending at top-level statement ends; returns
+   how many.  An unterminated comment ends the scan: the rest is one
+   chunk, which will fail and have the file reparsed whole. */
+static int split(struct file *f) {
+    const char *s = f->text.data;
+    size_t len = f->text.len, start = 0;
+    int depth = 0, parens = 0, line = 1, start_line = 1, n = 0;
+
+    f->chunks = xmalloc((len / CHUNK_BYTES + 1) * sizeof *f->chunks);
+
+    for (size_t i = 0; i < len; i++) {
+        switch (s[i]) {
+        case '\n':
+            line++;
+            continue;
+        case '/':
+            if (i + 1 < len && s[i + 1] == '/') {
+                const char *nl = memchr(s + i, '\n', len - i);
+                i = nl ? (size_t) (nl - s) - 1 : len;
+            } else if (i + 1 < len && s[i + 1] == '*') {
+                for (i += 2; i + 1 < len &&
+                             !(s[i] == '*' && s[i + 1] == '/'); i++)
+                    if (s[i] == '\n')
+                        line++;
+                if (i + 1 >= len)
+                    goto done;
+                i++;
+            }
+            continue;
+        case '{':
+            depth++;
+            continue;
+        case '}':
+            depth--;
+            break;
+        case '(':
+            parens++;
+            continue;
+        case ')':
+            parens--;
+            continue;
+        case ';':
+            break;
+        default:
+            continue;
+        }
+        if (depth == 0 && parens == 0 && i + 1 - start >= CHUNK_BYTES &&
+            !continues(s, i + 1, len)) {
+            f->chunks[n++] = (struct task) { TASK_CHUNK, f, start, i + 1,
+                                             start_line };
+            start = i + 1;
+            start_line = line;
+        }
+    }
+done:
+    f->chunks[n++] = (struct task) { TASK_CHUNK, f, start, len, start_line };
+    return n;
+}
+
+/* The file is done: hand its verdict to the printer */
+static void finish(struct pool *pool, struct file *f, int status) {
+    strbuf_free(&f->text);
+    f->verdict.status = status;
+    verdict_push(&pool->done, &f->verdict);
+}
+
+static void parse_whole(struct pool *pool, struct file *f, struct job *j) {
+    struct parser *p = j->parser;
+
+    if (parser_parse_buffer(p, f->text.data, f->text.len) == 0) {
+        finish(pool, f, 0);
+    } else {
+        f->verdict.diags  = diag_buf_add(&j->diags, f->verdict.file, p);
+        f->verdict.ndiags = p->errors;
+        finish(pool, f, 1);
+    }
+}
+
+static void run_file(struct sched *s, int worker, struct pool *pool,
+                     struct file *f) {
+    int fd = open(f->path, O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0 || strbuf_read_fd(&f->text, fd) < 0) {
+        f->verdict.error = errno;
+        if (fd >= 0)
+            close(fd);
+        finish(pool, f, 2);
+        return;
+    }
+    close(fd);
+    /* flex scans the buffer in place: it needs two NULs at the end */
+    strbuf_reserve(&f->text, 2);
+    f->text.data[f->text.len] = f->text.data[f->text.len + 1] = '\0';
+
+    int n = f->text.len >= SPLIT_BYTES &&
+            !pool->jobs[worker].parser->check_bounds ? split(f) : 1;
+    if (n == 1) {
+        parse_whole(pool, f, &pool->jobs[worker]);
+        return;
+    }
+    atomic_store(&f->left, n);
+    /* the owner takes the last pushed first: start at the front */
+    for (int i = n - 1; i >= 0; i--)
+        sched_push(s, worker, &f->chunks[i]);
+}
+
+static void run_chunk(struct pool *pool, struct task *t, struct job *j) {
+    struct file *f = t->file;
+    size_t len = t->end - t->start;
+
+    /* once one chunk has failed the others are moot */
+    if (!atomic_load_explicit(&f->failed, memory_order_relaxed)) {
+        /* a copy: parsing in place would write NULs over the next chunk */
+        strbuf_reset(&j->chunk);
+        strbuf_reserve(&j->chunk, len + 2);
+        memcpy(j->chunk.data, f->text.data + t->start, len);
+        j->chunk.data[len] = j->chunk.data[len + 1] = '\0';
+        if (parser_parse_at(j->parser, j->chunk.data, len, t->line) != 0)
+            atomic_store(&f->failed, 1);
+    }
+    if (atomic_fetch_sub(&f->left, 1) == 1) {
+        /* last one in: every other chunk is finished */
+        if (atomic_load(&f->failed))
+            parse_whole(pool, f, j);
+        else
+            finish(pool, f, 0);
+    }
+}
+
+static void run(struct sched *s, int worker, void *task, void *ctx) {
+    struct pool *pool = ctx;
+    struct task *t = task;
+
+    if (t->kind == TASK_FILE)
+        run_file(s, worker, pool, t->file);
+    else
+        run_chunk(pool, t, &pool->jobs[worker]);
+}
+
+/* Print each verdict once every file before it has been printed */
+static void *print_verdicts(void *arg) {
+    struct pool *pool = arg;
+    char *ready = xcalloc(pool->nfiles, 1);
+    int next = 0;
+    while (next < pool->nfiles) {
+        ready[verdict_pop(&pool->done)->file] = 1;
+        for (; next < pool->nfiles && ready[next]; next++) {
+            const struct file *f = &pool->files[next];
+
+            report_verdict(pool->report, f->path, &f->verdict);
+            if (f->verdict.status > pool->status)
+                pool->status = f->verdict.status;
+        }
+    }
+    free(ready);
+    return NULL;
+}
+
+static int by_size_desc(const void *a, const void *b) {
+    const struct file *x = *(struct file *const *) a;
+    const struct file *y = *(struct file *const *) b;
+    if (x->size != y->size)
+        return x->size < y->size ? 1 : -1;
+    return x < y ? -1 : x > y;
+}
+
+static int check_parallel(struct parser *p, char **paths, int n, int njobs,
+                          struct report *r) {
+    struct pool pool = {
+        .jobs   = xcalloc(njobs, sizeof *pool.jobs),
+        .files  = xcalloc(n, sizeof *pool.files),
+        .nfiles = n,
+        .report = r,
+    };
+    struct file **order = xmalloc(n * sizeof *order);
+    struct sched *s = sched_new(njobs);
+    pthread_t printer;
+    int printing;
+
+    verdict_queue_init(&pool.done);
+
+    for (int i = 0; i < n; i++) {
+        struct file *f = &pool.files[i];
+        struct stat st;
+        f->path  = paths[i];
+        f->size  = stat(paths[i], &st) == 0 ? st.st_size : 0;
+        f->whole = (struct task) { TASK_FILE, f, 0, 0, 1 };
+        f->verdict.file = i;
+        order[i] = f;
+    }
+    qsort(order, n, sizeof *order, by_size_desc);
+
+    /* Deal round-robin, largest first; each owner takes its largest
+       first, so push them last */
+    for (int i = n - 1; i >= 0; i--)
+        sched_push(s, i % njobs, &order[i]->whole);
+
+    for (int i = 0; i < njobs; i++) {
+        struct job *j = &pool.jobs[i];
+        j->parser = parser_new();
+        parser_set_dialect(j->parser, p->dialect);
+        j->parser->rd = p->rd;
+        j->parser->check_bounds = p->check_bounds;
+        j->parser->stacks.max_depth = p->stacks.max_depth;
+        if (p->stats) {
+            parser_stats_begin(j->parser, &j->stats);
+            j->parser->stats = &j->stats;
+        }
+    }
+
+    /* verdicts stream out in order while later files are parsed; if
+       there is no thread for that they all wait in the queue */
+    printing = pthread_create(&printer, NULL, print_verdicts, &pool) == 0;
+    sched_run(s, run, &pool);
+    if (printing)
+        pthread_join(printer, NULL);
+    else
+        print_verdicts(&pool);
+
+    if (p->stats) {
+        /* kept, like the counters, until the report */
+        struct worker_stats *w = xmalloc(njobs * sizeof *w);
+        memcpy(w, sched_stats(s), njobs * sizeof *w);
+        p->stats->io       = "read";
+        p->stats->nworkers = njobs;
+        p->stats->workers  = w;
+    }
+    for (int i = 0; i < njobs; i++) {
+        struct job *j = &pool.jobs[i];
+        if (p->stats) {
+            stats_merge(p->stats, &j->stats);
+            free(j->stats.token_counts);
+            free(j->stats.rule_counts);
+        }
+        parser_free(j->parser);
+        strbuf_free(&j->chunk);
+        diag_buf_free(&j->diags);
+    }
+    for (int i = 0; i < n; i++)
+        free(pool.files[i].chunks);
+    sched_free(s);
+    free(pool.jobs);
+    free(pool.files);
+    free(order);
+    return pool.status;
+}
+
+int check_files(struct parser *p, char **paths, int n, int jobs, int uring,
+                struct report *r) {
+    if (p->stats)
+        p->stats->files = (unsigned long) n;
+    if (jobs > 1 && n > 0)
+        return check_parallel(p, paths, n, jobs, r);
+    return check_in_order(p, paths, n, uring, r);
+}
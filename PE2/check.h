@@ -0,0 +1,19 @@
+/*
+ * check.h - Checking the files named on the command line
+ */
+
+#ifndef CHECK_H
+#define CHECK_H
+
+#include "format.h"
+#include "parser.h"
+
+/* Check paths[0 .. n) and report a verdict for each to r, in order.
+   With one job p parses every file, read ahead through ingest.c (uring
+   0 forces plain reads); with more, each worker thread owns a parser
+   like p.  Returns 0 if all are valid, 1 on a syntax error, 2 if a file
+   could not be read. */
+int check_files(struct parser *p, char **paths, int n, int jobs, int uring,
+                struct report *r);
+
+#endif /* CHECK_H */
@@ -0,0 +1,302 @@
+/*
+ * daemon.c - c_parserd, a long-running validation server
+ *
+ *     ./c_parserd [-j N] [--max-depth=N] [--dialect=pe2|a1] SOCKET
+ *
+ * Listens on the Unix domain socket SOCKET, replacing a socket a crash
+ * left there but no other kind of file.  A connection carries any
+ * number of requests, answered in order:
+ *
+ *   request : u32 length (network byte order), then that many bytes
+ *             of source text
+ *   reply   : u32 length (network byte order), then
+ *               1 byte   status, as c_parser's exit status
+ *                        (0 valid, 1 syntax error, 2 bad request)
+ *               n bytes  diagnostics, one per line, exactly as
+ *                        c_parser prints them to stderr
+ *
+ * N worker threads (default: one per CPU) wait on one epoll instance
+ * holding the listening socket and every connection.  A worker takes
+ * one ready connection, answers one request on it and hands it back, so
+ * idle clients hold no worker and each request waits only for those
+ * ahead of it.  A connection is disarmed (EPOLLONESHOT) while its
+ * request is answered: its replies go out in order.  A request that
+ * stalls halfway, or a reply the client does not read, closes the
+ * connection after REQUEST_TIMEOUT seconds.  Each worker owns one
+ * reentrant parser instance for its whole life, so the scanner, the
+ * parser stacks and the input and reply buffers are allocated once and
+ * stay warm between requests.  Every request is checked in the one
+ * dialect given (default pe2).
+ */
+
+#define _GNU_SOURCE             /* accept4 */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "parser.h"
+
+/* Largest accepted request body */
+#define MAX_REQUEST (64u << 20)
+
+/* Seconds a request may take to arrive, or a reply to be read */
+#define REQUEST_TIMEOUT 5
+
+static int         listen_fd = -1;
+static int         epoll_fd = -1;
+static const char *socket_path;
+static volatile sig_atomic_t bound;     /* socket_path is our socket */
+static long        max_depth = DEFAULT_MAX_DEPTH;
+static int         dialect = DIALECT_PE2;
+
+/* ================================================================
+   Socket I/O
+   ================================================================ */
+
+/* Read exactly len bytes; 0 on success, -1 on error or early EOF */
+static int read_full(int fd, void *buf, size_t len) {
+    char *p = buf;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n == 0)
+            return -1;
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        p   += n;
+        len -= (size_t) n;
+    }
+    return 0;
+}
+
+static int write_full(int fd, const void *buf, size_t len) {
+    const char *p = buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        p   += n;
+        len -= (size_t) n;
+    }
+    return 0;
+}
+
+/* Frame status + text into reply (length prefix first) and send it */
+static int send_reply(int fd, struct strbuf *reply, int status,
+                      const char *text, size_t len) {
+    uint32_t n = htonl((uint32_t) (len + 1));
+    unsigned char st = (unsigned char) status;
+
+    strbuf_reset(reply);
+    strbuf_add(reply, &n, sizeof n);
+    strbuf_add(reply, &st, 1);
+    strbuf_add(reply, text, len);
+    return write_full(fd, reply->data, reply->len);
+}
+
+/* ================================================================
+   Workers
+   ================================================================ */
+
+/* Answer the next request on a connection: 0 if it stays open, -1 if
+   the client hung up, timed out or sent too much */
+static int serve(int fd, struct parser *p, struct strbuf *reply) {
+    uint32_t n;
+
+    if (read_full(fd, &n, sizeof n) < 0)
+        return -1;
+    n = ntohl(n);
+    if (n > MAX_REQUEST) {
+        static const char msg[] = "Request too large\n";
+        send_reply(fd, reply, 2, msg, sizeof msg - 1);
+        return -1;
+    }
+
+    /* Read straight into the instance's input buffer, padded for
+       flex, so the request is never copied */
+    strbuf_reset(&p->input);
+    strbuf_reserve(&p->input, (size_t) n + 2);
+    if (read_full(fd, p->input.data, n) < 0)
+        return -1;
+    p->input.data[n] = p->input.data[n + 1] = '\0';
+    p->input.len = n;
+
+    int status = parser_parse_buffer(p, p->input.data, n);
+    return send_reply(fd, reply, status, p->diag.data, p->diag.len);
+}
+
+/* Add (op EPOLL_CTL_ADD) or re-arm (EPOLL_CTL_MOD) a connection for
+   its next request */
+static int watch_fd(int op, int fd) {
+    struct epoll_event ev = { .events = EPOLLIN | EPOLLONESHOT,
+                              .data.fd = fd };
+    return epoll_ctl(epoll_fd, op, fd, &ev);
+}
+
+/* Take a new connection, if another worker has not */
+static void take_connection(void) {
+    struct timeval tv = { .tv_sec = REQUEST_TIMEOUT };
+    int fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+
+    if (fd < 0) {
+        if (errno == EAGAIN || errno == EINTR || errno == ECONNABORTED)
+            return;
+        perror("accept");
+        exit(1);
+    }
+    if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv) < 0 ||
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof tv) < 0 ||
+        watch_fd(EPOLL_CTL_ADD, fd) < 0)
+        close(fd);
+}
+
+static void *worker(void *arg) {
+    struct parser *p = parser_new();
+    struct strbuf reply = { 0 };
+
+    (void) arg;
+    parser_set_dialect(p, dialect);
+    p->stacks.max_depth = max_depth;
+    for (;;) {
+        struct epoll_event ev;
+        int n = epoll_wait(epoll_fd, &ev, 1, -1);
+
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("epoll_wait");
+            exit(1);
+        }
+        if (n == 0)
+            continue;
+        if (ev.data.fd == listen_fd) {
+            take_connection();
+            continue;
+        }
+        /* disarmed until re-armed here: no other worker has it */
+        if (serve(ev.data.fd, p, &reply) < 0 ||
+            watch_fd(EPOLL_CTL_MOD, ev.data.fd) < 0)
+            close(ev.data.fd);
+    }
+    return NULL;
+}
+
+/* ================================================================
+   main
+   ================================================================ */
+static void on_signal(int sig) {
+    if (bound)
+        unlink(socket_path);
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [-j N] [--max-depth=N] [--dialect=pe2|a1] "
+                    "SOCKET\n", argv0);
+}
+
+int main(int argc, char **argv) {
+    long nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+
+    for (int i = 1; i < argc; i++) {
+        char *end;
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            nthreads = strtol(argv[++i], &end, 10);
+            if (*end != '\0' || nthreads < 1) {
+                usage(argv[0]);
+                return 2;
+            }
+        } else if (strncmp(argv[i], "--max-depth=", 12) == 0 &&
+                   argv[i][12] != '\0' &&
+                   (max_depth = strtol(argv[i] + 12, &end, 10)) >= 0 &&
+                   *end == '\0') {
+            /* 0 = unlimited */
+        } else if (strncmp(argv[i], "--dialect=", 10) == 0 &&
+                   (dialect = parser_dialect(argv[i] + 10)) >= 0) {
+            /* pe2 or a1 */
+        } else if (argv[i][0] != '-' && !socket_path) {
+            socket_path = argv[i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!socket_path || strlen(socket_path) >= sizeof addr.sun_path) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (nthreads < 1)
+        nthreads = 1;
+
+    strcpy(addr.sun_path, socket_path);
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                       0);
+    if (listen_fd < 0) {
+        perror("socket");
+        return 2;
+    }
+
+    /* a socket left by a crash is replaced; anything else is not ours */
+    struct stat st;
+    if (lstat(socket_path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            fprintf(stderr, "%s: exists and is not a socket\n",
+                    socket_path);
+            return 2;
+        }
+        unlink(socket_path);
+    }
+    if (bind(listen_fd, (struct sockaddr *) &addr, sizeof addr) < 0) {
+        perror(socket_path);
+        return 2;
+    }
+    bound = 1;
+    if (listen(listen_fd, 128) < 0) {
+        perror(socket_path);
+        unlink(socket_path);
+        return 2;
+    }
+
+    /* the listening socket stays armed: any idle worker may accept */
+    struct epoll_event ev = { .events = EPOLLIN, .data.fd = listen_fd };
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev)) {
+        perror("epoll");
+        unlink(socket_path);
+        return 2;
+    }
+
+    signal(SIGPIPE, SIG_IGN);           /* clients may hang up early */
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    for (long i = 1; i < nthreads; i++) {
+        pthread_t tid;
+        if (pthread_create(&tid, NULL, worker, NULL) != 0) {
+            perror("pthread_create");
+            return 2;
+        }
+        pthread_detach(tid);
+    }
+    worker(NULL);                       /* the main thread serves too */
+    return 0;
+}
@@ -0,0 +1,183 @@
+/*
+ * diag.c - Diagnostics from parallel workers, printed in order
+ *          (see diag.h)
+ */
+
+#include <linux/futex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "diag.h"
+#include "strbuf.h"
+
+#define BLOCK_MIN   (64 * 1024)
+
+/* Records are laid out from the start of a block, their text after them */
+struct diag_block {
+    struct diag_block *next;
+    size_t             used;
+    size_t             cap;
+    _Alignas(struct diag) char data[];
+};
+
+/* ================================================================
+   Per-thread buffers
+   ================================================================ */
+
+/* size bytes, aligned for struct diag, that stay where they are */
+static char *diag_alloc(struct diag_buf *b, size_t size) {
+    struct diag_block *blk = b->blocks;
+
+    size = (size + _Alignof(struct diag) - 1) & ~(_Alignof(struct diag) - 1);
+    if (!blk || blk->cap - blk->used < size) {
+        size_t cap = size > BLOCK_MIN ? size : BLOCK_MIN;
+        blk = xmalloc(sizeof *blk + cap);
+        blk->next = b->blocks;
+        blk->used = 0;
+        blk->cap  = cap;
+        b->blocks = blk;
+    }
+    blk->used += size;
+    return blk->data + blk->used - size;
+}
+
+const struct diag *diag_buf_add(struct diag_buf *b, int file,
+                                const struct parser *p) {
+    const int *kinds = (const int *) p->expected.data;
+    size_t size = p->errors * sizeof(struct diag);
+
+    for (int i = 0; i < p->errors; i++)
+        size += p->diags[i].nexpected * sizeof(const char *) +
+                p->diags[i].msg_len + p->diags[i].tok_len + 2;
+
+    struct diag *d = (struct diag *) diag_alloc(b, size);
+    const char **expected = (const char **) (d + p->errors);
+
+    for (int i = 0; i < p->errors; i++) {
+        const struct parse_diag *pd = &p->diags[i];
+
+        d[i].file      = file;
+        d[i].line      = pd->line;
+        d[i].column    = pd->column;
+        d[i].kind      = pd->kind < 0 ? NULL
+                                      : parser_token_name(p, pd->kind);
+        d[i].expected  = expected;
+        d[i].nexpected = pd->nexpected;
+        for (int k = 0; k < pd->nexpected; k++)
+            *expected++ = parser_token_name(p, kinds[pd->expected + k]);
+    }
+
+    char *text = (char *) expected;
+    for (int i = 0; i < p->errors; i++) {
+        const struct parse_diag *pd = &p->diags[i];
+
+        d[i].message = text;
+        memcpy(text, p->diag.data + pd->msg, pd->msg_len);
+        text += pd->msg_len;
+        *text++ = '\0';
+        d[i].token   = text;
+        memcpy(text, p->tokens.data + pd->tok, pd->tok_len);
+        text += pd->tok_len;
+        *text++ = '\0';
+    }
+    return d;
+}
+
+void diag_buf_reset(struct diag_buf *b) {
+    /* the newest block is the largest: keep it */
+    if (!b->blocks)
+        return;
+    struct diag_block *keep = b->blocks;
+    b->blocks = keep->next;
+    diag_buf_free(b);
+    keep->next = NULL;
+    keep->used = 0;
+    b->blocks = keep;
+}
+
+void diag_buf_free(struct diag_buf *b) {
+    while (b->blocks) {
+        struct diag_block *next = b->blocks->next;
+        free(b->blocks);
+        b->blocks = next;
+    }
+}
+
+/* ================================================================
+   Verdict queue
+   ================================================================ */
+
+static void futex(atomic_int *addr, int op, int val) {
+    syscall(SYS_futex, addr, op | FUTEX_PRIVATE_FLAG, val, NULL, NULL, 0);
+}
+
+void verdict_queue_init(struct verdict_queue *q) {
+    atomic_init(&q->stub.next, NULL);
+    atomic_init(&q->head, &q->stub);
+    q->tail = &q->stub;
+    atomic_init(&q->posted, 0);
+    atomic_init(&q->waiting, 0);
+}
+
+static void link_in(struct verdict_queue *q, struct verdict *v) {
+    atomic_store_explicit(&v->next, NULL, memory_order_relaxed);
+    struct verdict *prev = atomic_exchange_explicit(&q->head, v,
+                                                    memory_order_acq_rel);
+    /* until this store the consumer cannot see v, nor anything after */
+    atomic_store_explicit(&prev->next, v, memory_order_release);
+}
+
+void verdict_push(struct verdict_queue *q, struct verdict *v) {
+    link_in(q, v);
+    atomic_fetch_add(&q->posted, 1);
+    if (atomic_load(&q->waiting))
+        futex(&q->posted, FUTEX_WAKE, 1);
+}
+
+/* The next verdict, or NULL if there is none or a push is half done */
+static struct verdict *try_pop(struct verdict_queue *q) {
+    struct verdict *tail = q->tail;
+    struct verdict *next = atomic_load_explicit(&tail->next,
+                                                memory_order_acquire);
+
+    if (tail == &q->stub) {
+        if (!next)
+            return NULL;
+        q->tail = tail = next;
+        next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    }
+    if (next) {
+        q->tail = next;
+        return tail;
+    }
+    if (tail != atomic_load_explicit(&q->head, memory_order_acquire))
+        return NULL;
+    /* tail is the last one: put the stub behind it to take it */
+    link_in(q, &q->stub);
+    next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    if (next) {
+        q->tail = next;
+        return tail;
+    }
+    return NULL;
+}
+
+struct verdict *verdict_pop(struct verdict_queue *q) {
+    struct verdict *v;
+
+    while ((v = try_pop(q)) == NULL) {
+        /* a push counts itself after linking in, so a count seen
+           before the second try covers anything that try missed */
+        atomic_store(&q->waiting, 1);
+        int seen = atomic_load(&q->posted);
+        if ((v = try_pop(q)) == NULL)
+            futex(&q->posted, FUTEX_WAIT, seen);
+        atomic_store(&q->waiting, 0);
+        if (v)
+            break;
+    }
+    return v;
+}
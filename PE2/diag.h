@@ -0,0 +1,75 @@
+/*
+ * diag.h - Diagnostics from parallel workers, printed in order
+ *
+ * Each worker thread copies the diagnostics of a failed file into a
+ * buffer of its own, without locking, and queues the file's verdict on
+ * a lock-free multi-producer, single-consumer queue.  One printing
+ * thread takes verdicts off the queue and prints them in file order as
+ * soon as every earlier file is done, so the output is exactly that of
+ * checking the files one after the other.
+ */
+
+#ifndef DIAG_H
+#define DIAG_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+#include "parser.h"
+
+/* One diagnostic, as the thread that found it recorded it */
+struct diag {
+    int          file;      /* index on the command line            */
+    int          line;      /* line it was reported at              */
+    int          column;    /* of the token, from 1 (0: unknown)    */
+    const char  *kind;      /* the token's symbol kind, or NULL     */
+    const char  *token;     /* text of the token being scanned      */
+    const char  *message;   /* the line c_parser prints for it      */
+    const char *const *expected; /* symbol kinds the parser would   */
+    int          nexpected; /*   have accepted there                */
+};
+
+/* A thread's diagnostics: append-only until diag_buf_reset() */
+struct diag_buf {
+    struct diag_block *blocks;
+};
+
+/* Copy the diagnostics p collected for file, with the symbol kinds
+   named in p's dialect; returns the first of p->errors consecutive
+   records */
+const struct diag *diag_buf_add(struct diag_buf *b, int file,
+                                const struct parser *p);
+
+/* Drop every record but keep the memory for the next ones */
+void diag_buf_reset(struct diag_buf *b);
+void diag_buf_free(struct diag_buf *b);
+
+/* A finished file, queued for printing */
+struct verdict {
+    _Atomic(struct verdict *) next;
+    int                 file;
+    int                 status;     /* 0 valid, 1 syntax error,
+                                       2 unreadable                 */
+    int                 error;      /* status 2: errno              */
+    const struct diag  *diags;      /* status 1                     */
+    int                 ndiags;
+};
+
+/* Vyukov's intrusive MPSC queue, with a futex to sleep on when empty */
+struct verdict_queue {
+    _Atomic(struct verdict *) head;     /* producers push here      */
+    struct verdict           *tail;     /* the consumer pops here   */
+    struct verdict            stub;
+    atomic_int                posted;   /* pushes so far            */
+    atomic_int                waiting;  /* the consumer is asleep   */
+};
+
+void verdict_queue_init(struct verdict_queue *q);
+
+/* Any thread */
+void verdict_push(struct verdict_queue *q, struct verdict *v);
+
+/* Consumer only: the next verdict, waiting for one if need be */
+struct verdict *verdict_pop(struct verdict_queue *q);
+
+#endif /* DIAG_H */
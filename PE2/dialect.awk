@@ -0,0 +1,84 @@
+# dialect.awk - Cut one dialect's grammar or scanner out of the shared
+#               source (parser.y, lexer.l)
+#
+# Usage: awk -v dialect=NAME -f dialect.awk parser.y > parser_NAME.y
+#
+#   %if NAME...              on lines of their own, possibly nested: keep
+#   %else                    the lines between only for the dialects named
+#   %endif
+#   %NAME{ ... }             inline, braces balanced on the line: becomes
+#                            "{ ... }" for NAME and disappears for the rest
+#   @dialect@  @DIALECT@     the dialect's name, lower and upper case
+#
+# Dropped lines and the directives themselves are printed as empty lines,
+# so Bison's and flex's messages point at the right line of the shared
+# source.
+
+function active(    i) {
+    for (i = 1; i <= depth; i++)
+        if (!on[i])
+            return 0
+    return 1
+}
+
+BEGIN {
+    upper = toupper(dialect)
+}
+
+/^%if[ \t]/ {
+    on[++depth] = 0
+    for (i = 2; i <= NF; i++)
+        if ($i == dialect)
+            on[depth] = 1
+    print ""
+    next
+}
+
+/^%else[ \t]*$/ {
+    on[depth] = !on[depth]
+    print ""
+    next
+}
+
+/^%endif[ \t]*$/ {
+    depth--
+    print ""
+    next
+}
+
+!active() {
+    print ""
+    next
+}
+
+{
+    line = $0
+    out = ""
+    while (match(line, /%[a-z][a-z0-9]*\{/)) {
+        name = substr(line, RSTART + 1, RLENGTH - 2)
+        out  = out substr(line, 1, RSTART - 1)
+        rest = substr(line, RSTART + RLENGTH - 1)
+        n    = 0
+        for (k = 1; k <= length(rest); k++) {
+            c = substr(rest, k, 1)
+            if (c == "{")
+                n++
+            else if (c == "}" && --n == 0)
+                break
+        }
+        if (name == dialect)
+            out = out substr(rest, 1, k)
+        line = substr(rest, k + 1)
+    }
+    line = out line
+    gsub(/@dialect@/, dialect, line)
+    gsub(/@DIALECT@/, upper, line)
+    print line
+}
+
+END {
+    if (depth != 0) {
+        print FILENAME ": unterminated %if" > "/dev/stderr"
+        exit 1
+    }
+}
@@ -0,0 +1,515 @@
+/*
+ * document.c - Incrementally reparsed source text (see document.h)
+ */
+
+#include "document.h"
+#include "strbuf.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Smallest text gap left after growing the buffer */
+#define MIN_GAP 4096
+
+/* ── State shared with on_statement() during one reparse ── */
+struct reparse {
+    const struct document *d;
+    size_t          base;       /* offset the parse started from         */
+    size_t          window;     /* ... and the one it stops at           */
+    int             next;       /* next old segment that may resync      */
+    int             sync;       /* old segment resynchronised on, or -1  */
+    struct segment *out;        /* segments found by this parse          */
+    int             nout;
+    int             cap;
+};
+
+static void *grow(void *items, int *cap, int need, size_t size) {
+    if (need <= *cap)
+        return items;
+    int n = *cap ? *cap : 64;
+    while (n < need)
+        n *= 2;
+    items = xrealloc(items, n * size);
+    *cap = n;
+    return items;
+}
+
+static int count_newlines(const char *s, size_t n) {
+    int count = 0;
+    const char *end = s + n;
+    while ((s = memchr(s, '\n', end - s)) != NULL) {
+        count++;
+        s++;
+    }
+    return count;
+}
+
+/* ================================================================
+   Text gap
+   ================================================================ */
+
+static void move_gap(struct document *d, size_t pos) {
+    if (pos < d->gap)
+        memmove(d->buf + pos + d->gap_len, d->buf + pos, d->gap - pos);
+    else if (pos > d->gap)
+        memmove(d->buf + d->gap, d->buf + d->gap + d->gap_len,
+                pos - d->gap);
+    d->gap = pos;
+}
+
+static void reserve_gap(struct document *d, size_t need) {
+    size_t tail = d->len - d->gap;
+    size_t cap = d->cap ? d->cap : MIN_GAP;
+
+    if (d->buf && d->gap_len >= need)
+        return;
+    while (cap - d->len < need + MIN_GAP)
+        cap *= 2;
+    char *buf = xrealloc(d->buf, cap);
+    memmove(buf + cap - tail, buf + d->gap + d->gap_len, tail);
+    d->buf     = buf;
+    d->cap     = cap;
+    d->gap_len = cap - d->len;
+}
+
+/* Make text [0, end) contiguous, followed by the two NULs flex needs */
+static char *contiguous(struct document *d, size_t end) {
+    move_gap(d, end);
+    reserve_gap(d, 2);
+    d->buf[end] = d->buf[end + 1] = '\0';
+    return d->buf;
+}
+
+static int count_newlines_in(const struct document *d,
+                             size_t start, size_t end) {
+    size_t split = end < d->gap ? end : d->gap;
+    int n = 0;
+
+    if (start < split)
+        n += count_newlines(d->buf + start, split - start);
+    if (end > d->gap) {
+        size_t from = start > d->gap ? start : d->gap;
+        n += count_newlines(d->buf + from + d->gap_len, end - from);
+    }
+    return n;
+}
+
+/* Offset of the first newline at or after from, or the text length */
+static size_t next_newline(const struct document *d, size_t from) {
+    const char *nl;
+
+    if (from < d->gap) {
+        nl = memchr(d->buf + from, '\n', d->gap - from);
+        if (nl)
+            return (size_t) (nl - d->buf);
+        from = d->gap;
+    }
+    nl = memchr(d->buf + from + d->gap_len, '\n', d->len - from);
+    return nl ? (size_t) (nl - d->buf) - d->gap_len : d->len;
+}
+
+/* ================================================================
+   Segment gap: segments past it count back from the end of the text
+   ================================================================ */
+
+struct segment document_segment(const struct document *d, int i) {
+    if (i < d->seg_gap)
+        return d->segs[i];
+
+    struct segment s = d->segs[i + d->seg_cap - d->nsegs];
+    s.start = d->len - s.start;
+    s.end   = d->len - s.end;
+    s.line  = d->lines - s.line;
+    return s;
+}
+
+static void seg_move_gap(struct document *d, int to) {
+    int hole = d->seg_cap - d->nsegs;
+
+    while (d->seg_gap > to) {
+        struct segment *s = &d->segs[--d->seg_gap];
+        struct segment *t = s + hole;
+        t->start = d->len - s->start;
+        t->end   = d->len - s->end;
+        t->line  = d->lines - s->line;
+    }
+    while (d->seg_gap < to) {
+        struct segment *s = &d->segs[d->seg_gap++];
+        struct segment *t = s + hole;
+        s->start = d->len - t->start;
+        s->end   = d->len - t->end;
+        s->line  = d->lines - t->line;
+    }
+}
+
+/* Insert segments at the gap */
+static void seg_insert(struct document *d, const struct segment *segs, int n) {
+    int old_cap = d->seg_cap;
+    int tail = d->nsegs - d->seg_gap;
+
+    d->segs = grow(d->segs, &d->seg_cap, d->nsegs + n, sizeof *d->segs);
+    if (d->seg_cap != old_cap)
+        memmove(d->segs + d->seg_cap - tail, d->segs + old_cap - tail,
+                tail * sizeof *d->segs);
+    if (n)
+        memcpy(d->segs + d->seg_gap, segs, n * sizeof *segs);
+    d->seg_gap += n;
+    d->nsegs   += n;
+}
+
+/* Index of the first segment from lo on ending at or after off */
+static int first_ending_from(const struct document *d, int lo, size_t off) {
+    int hi = d->nsegs;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (document_segment(d, mid).end < off)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* ================================================================
+   Errors: a short list kept in text order
+   ================================================================ */
+
+static void errors_remove(struct document *d, size_t from, size_t to) {
+    int i = 0, j;
+
+    while (i < d->nerrs && d->errs[i].start < from)
+        i++;
+    for (j = i; j < d->nerrs && d->errs[j].start < to; j++)
+        free(d->errs[j].diag);
+    if (j > i) {
+        memmove(d->errs + i, d->errs + j,
+                (d->nerrs - j) * sizeof *d->errs);
+        d->nerrs -= j - i;
+    }
+}
+
+static void errors_insert(struct document *d, struct doc_error e) {
+    int i = d->nerrs;
+
+    d->errs = grow(d->errs, &d->err_cap, d->nerrs + 1, sizeof *d->errs);
+    while (i > 0 && d->errs[i - 1].start > e.start)
+        i--;
+    memmove(d->errs + i + 1, d->errs + i, (d->nerrs - i) * sizeof *d->errs);
+    d->errs[i] = e;
+    d->nerrs++;
+}
+
+/* ================================================================
+   Parsing
+   ================================================================ */
+
+/* on_top: record each statement; stop once the parse lands on an old
+   boundary that lies past the edit (r->next only points at those).  A
+   statement ended by the window's end of input may yet continue (an if
+   can still take an else), so it never resynchronises. */
+static int on_statement(struct parser *p, size_t end) {
+    struct reparse *r = p->top_ctx;
+    size_t at = r->base + end;
+    size_t start = r->nout ? r->out[r->nout - 1].end : r->base;
+
+    r->out = grow(r->out, &r->cap, r->nout + 1, sizeof *r->out);
+    r->out[r->nout++] = (struct segment) { .start = start, .end = at };
+
+    while (r->next < r->d->nsegs &&
+           document_segment(r->d, r->next).end < at)
+        r->next++;
+    if (p->at_eof && r->window < r->d->len)
+        return 0;
+    if (r->next < r->d->nsegs &&
+        document_segment(r->d, r->next).end == at) {
+        r->sync = r->next;
+        return 1;
+    }
+    return 0;
+}
+
+/* Parse text [start, end) starting on line; diagnostics are collected */
+static int parse_range(struct document *d, struct parser *p,
+                       size_t start, size_t end, int line,
+                       int (*on_top)(struct parser *, size_t), void *ctx) {
+    char *buf = contiguous(d, end);
+    FILE *out = p->diag_out;
+    int result;
+
+    p->diag_out = NULL;
+    p->on_top   = on_top;
+    p->top_ctx  = ctx;
+    result = parser_parse_at(p, buf + start, end - start, line);
+    p->on_top   = NULL;
+    p->top_ctx  = NULL;
+    p->diag_out = out;
+    return result;
+}
+
+static char *diag_copy(const struct parser *p) {
+    char *s = xmalloc(p->diag.len + 1);
+    memcpy(s, p->diag.data, p->diag.len);
+    s[p->diag.len] = '\0';
+    return s;
+}
+
+/* An error's message names its line: redo it after lines shift */
+static void rediagnose(struct document *d, struct parser *p,
+                       struct doc_error *e) {
+    parse_range(d, p, e->start, e->end, e->line, NULL, NULL);
+    free(e->diag);
+    e->diag     = diag_copy(p);
+    e->err_line = p->err_line;
+    e->moved    = 0;
+}
+
+/*
+ * Reparse from segment first, which starts at base on line: the parser
+ * is between top-level statements there.  The gap is at first, so the
+ * old segments from first on count from the end of the (edited) text
+ * and already sit at their new offsets; those from lo on end at or past
+ * min_end, the end of the edit.  Returns where the new segments end.
+ */
+static size_t reparse(struct document *d, struct parser *p, int first,
+                      int lo, size_t base, int line, size_t min_end) {
+    struct reparse r = { .d = d, .base = base };
+    int k0 = first_ending_from(d, lo, min_end);
+    int kx = k0 + 1;
+    size_t window;
+    int last, result;
+
+    /* Scan up to an old boundary one statement past the edit, and
+       widen the window while the parse runs into its end */
+    for (;;) {
+        window = kx < d->nsegs ? document_segment(d, kx).end : d->len;
+        r.window = window;
+        r.nout = 0;
+        r.next = k0;
+        r.sync = -1;
+        result = parse_range(d, p, base, window, line, on_statement, &r);
+        if (r.sync >= 0 || window == d->len ||
+            (!p->at_eof && base + p->tok_end < window))
+            break;
+        kx += kx - first + 1;
+    }
+
+    /* Which old segments the new ones replace */
+    if (result == 0) {
+        last = r.sync >= 0 ? r.sync + 1 : d->nsegs;
+    } else {
+        size_t at = r.nout ? r.out[r.nout - 1].end : base;
+        size_t err = base + p->tok_end;
+        size_t end = d->len;
+        int k = d->nsegs;
+
+        /* Resume at the first old boundary past the error */
+        if (!p->at_eof && err < d->len) {
+            for (k = r.next; k < d->nsegs; k++)
+                if ((end = document_segment(d, k).end) >= err)
+                    break;
+            if (k == d->nsegs)
+                end = d->len;
+        }
+        last = k < d->nsegs ? k + 1 : d->nsegs;
+
+        r.out = grow(r.out, &r.cap, r.nout + 1, sizeof *r.out);
+        r.out[r.nout++] = (struct segment) { .start = at, .end = end };
+    }
+
+    for (int i = 0; i < r.nout; i++) {
+        r.out[i].line = line;
+        line += count_newlines_in(d, r.out[i].start, r.out[i].end);
+    }
+    size_t new_end = r.nout ? r.out[r.nout - 1].end : base;
+    d->reparsed += new_end - base;
+
+    /* Old segments [first, last) follow the gap: drop them, and the
+       errors of any among them (at end of input they may reach past
+       the new ones) */
+    size_t old_end = last > first ? document_segment(d, last - 1).end : base;
+    if (old_end < new_end)
+        old_end = new_end;
+    d->nsegs -= last - first;
+    seg_insert(d, r.out, r.nout);
+
+    errors_remove(d, base, old_end > base ? old_end : base + 1);
+    if (result != 0) {
+        const struct segment *s = &r.out[r.nout - 1];
+        errors_insert(d, (struct doc_error) {
+            .start    = s->start,
+            .end      = s->end,
+            .line     = s->line,
+            .err_line = p->err_line,
+            .diag     = diag_copy(p),
+        });
+    }
+    free(r.out);
+    return new_end;
+}
+
+/*
+ * Splice edit e into the text.  The segments it overlaps are dropped
+ * (the reparse replaces them) and the gap is left in front of the rest,
+ * which count from the end of the text and so move with it.
+ */
+static void splice(struct document *d, const struct doc_edit *e) {
+    size_t start = e->start, end = e->end;
+    ptrdiff_t delta = (ptrdiff_t) e->len - (ptrdiff_t) (end - start);
+    int dlines = count_newlines(e->text, e->len)
+               - count_newlines_in(d, start, end);
+    int k = first_ending_from(d, 0, start);
+    int m = first_ending_from(d, k, end);
+
+    seg_move_gap(d, k);
+    d->nsegs -= m - k;
+
+    /* Errors overlapping the edit go with their segments; later ones
+       move with the text, and their messages name stale lines */
+    for (int i = 0; i < d->nerrs; i++) {
+        struct doc_error *err = &d->errs[i];
+        if (err->start < end && err->end > start) {
+            free(err->diag);
+            memmove(err, err + 1, (d->nerrs - i - 1) * sizeof *err);
+            d->nerrs--;
+            i--;
+        } else if (err->start >= end) {
+            err->start     = (size_t) ((ptrdiff_t) err->start + delta);
+            err->end       = (size_t) ((ptrdiff_t) err->end + delta);
+            err->line     += dlines;
+            err->err_line += dlines;
+            err->moved    |= dlines != 0;
+        }
+    }
+
+    move_gap(d, start);
+    d->gap_len += end - start;
+    d->len     -= end - start;
+    reserve_gap(d, e->len);
+    memcpy(d->buf + d->gap, e->text, e->len);
+    d->gap     += e->len;
+    d->gap_len -= e->len;
+    d->len     += e->len;
+    d->lines   += dlines;
+}
+
+/* ================================================================
+   Public interface
+   ================================================================ */
+void document_set(struct document *d, struct parser *p,
+                  const char *text, size_t len) {
+    errors_remove(d, 0, (size_t) -1);
+    d->nsegs   = 0;
+    d->seg_gap = 0;
+
+    d->gap     = d->len = 0;
+    d->gap_len = d->cap;
+    reserve_gap(d, len + 2);
+    memcpy(d->buf, text, len);
+    d->gap     = d->len = len;
+    d->gap_len = d->cap - len;
+    d->lines   = 1 + count_newlines(text, len);
+
+    d->reparsed = 0;
+    reparse(d, p, 0, 0, 0, 1, 0);
+}
+
+int document_apply(struct document *d, struct parser *p,
+                   const struct doc_edit *edits, int n) {
+    struct doc_edit *e = xmalloc((n ? n : 1) * sizeof *e);
+
+    /* Clamp to the text, then check the order */
+    for (int i = 0; i < n; i++) {
+        e[i] = edits[i];
+        if (e[i].end > d->len)
+            e[i].end = d->len;
+        if (e[i].start > e[i].end)
+            e[i].start = e[i].end;
+        if (i > 0 && e[i].start < e[i - 1].end) {
+            free(e);
+            return -1;
+        }
+    }
+
+    /* Splice back to front, so the offsets of the edits still to come
+       hold.  Afterwards each edit's offsets are kept counted from the
+       end of the text, which the edits in front of it do not change. */
+    for (int i = n - 1; i >= 0; i--) {
+        splice(d, &e[i]);
+        e[i].end   = d->len - (e[i].start + e[i].len);
+        e[i].start = d->len - e[i].start;
+    }
+
+    /* Reparse front to back; a reparse that ran past the end of later
+       edits has already covered them */
+    size_t done = 0;
+    d->reparsed = 0;
+    for (int i = 0; i < n; i++) {
+        size_t start   = d->len - e[i].start;
+        size_t min_end = d->len - e[i].end;
+        if (i > 0 && done >= min_end)
+            continue;
+
+        /* Restart one statement early: an edit just after an if
+           statement can give it an else branch */
+        int k = first_ending_from(d, 0, start);
+        int first = k > 0 ? k - 1 : 0;
+        struct segment s = { 0, 0, 1 };
+        if (k > 0)
+            s = document_segment(d, first);
+        seg_move_gap(d, first);
+        done = reparse(d, p, first, k, s.start, s.line, min_end);
+    }
+    free(e);
+
+    for (int i = 0; i < d->nerrs; i++)
+        if (d->errs[i].moved)
+            rediagnose(d, p, &d->errs[i]);
+    return 0;
+}
+
+void document_edit(struct document *d, struct parser *p,
+                   size_t start, size_t end, const char *text, size_t len) {
+    struct doc_edit e = { start, end, text, len };
+    document_apply(d, p, &e, 1);
+}
+
+const char *document_text(struct document *d) {
+    return contiguous(d, d->len);
+}
+
+size_t document_line_start(const struct document *d, int line) {
+    int lo = 0, hi = d->nsegs;
+    size_t at = 0;
+    int at_line = 1;
+
+    /* Last segment starting before the line (segments start mid-line),
+       then count newlines forward */
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (document_segment(d, mid).line < line)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo > 0) {
+        struct segment s = document_segment(d, lo - 1);
+        at      = s.start;
+        at_line = s.line;
+    }
+    for (; at_line < line; at_line++) {
+        at = next_newline(d, at);
+        if (at == d->len)
+            return at;
+        at++;
+    }
+    return at;
+}
+
+void document_free(struct document *d) {
+    errors_remove(d, 0, (size_t) -1);
+    free(d->errs);
+    free(d->segs);
+    free(d->buf);
+    memset(d, 0, sizeof *d);
+}
@@ -0,0 +1,110 @@
+/*
+ * document.h - Incrementally reparsed source text
+ *
+ * A document keeps its text together with the extent of every top-level
+ * statement found by the last parse.  Between two top-level statements
+ * the parser is always in the same state, so each boundary is a point
+ * where parsing can restart: an edit reparses from the statement before
+ * it only until the new parse lands on an old boundary past the edit,
+ * and every statement after that is kept as it was.
+ *
+ * Segments cover the text from offset 0 to the end of the last
+ * statement; each one is the statement plus the whitespace and comments
+ * in front of it.  A syntax error turns the text from the last good
+ * boundary to the next old boundary past the error (or to the end of
+ * the text) into one error segment, listed in errs with its diagnostic.
+ *
+ * Both the text and the segment array are gap buffers split at the last
+ * edit, and segments past the gap count from the end of the text, so an
+ * edit moves and renumbers nothing beyond the statements it reparses:
+ * the cost of a keystroke does not grow with the file.
+ */
+
+#ifndef DOCUMENT_H
+#define DOCUMENT_H
+
+#include <stddef.h>
+
+#include "parser.h"
+
+struct segment {
+    size_t  start;      /* byte offsets, [start, end)     */
+    size_t  end;
+    int     line;       /* line of start                  */
+};
+
+struct doc_error {
+    size_t  start;      /* extent of the error segment    */
+    size_t  end;
+    int     line;       /* line of start                  */
+    int     err_line;   /* line the diagnostic names      */
+    char   *diag;       /* diagnostic text                */
+    int     moved;      /* lines shifted since diag made  */
+};
+
+struct document {
+    /* Text: buf[0 .. gap) then buf[gap + gap_len .. cap) */
+    char             *buf;
+    size_t            cap;
+    size_t            gap;
+    size_t            gap_len;
+    size_t            len;
+    int               lines;    /* newlines + 1 */
+
+    /* Segments: segs[0 .. seg_gap) hold offsets from the start of the
+       text, the nsegs - seg_gap after the hole offsets from its end */
+    struct segment   *segs;
+    int               nsegs;
+    int               seg_cap;
+    int               seg_gap;
+
+    struct doc_error *errs;     /* in text order */
+    int               nerrs;
+    int               err_cap;
+
+    size_t            reparsed; /* bytes reparsed by the last update */
+};
+
+/* Replace the whole text and parse it from scratch */
+void document_set(struct document *d, struct parser *p,
+                  const char *text, size_t len);
+
+/* Replace bytes [start, end) with text[0 .. len) */
+struct doc_edit {
+    size_t      start;
+    size_t      end;
+    const char *text;
+    size_t      len;
+};
+
+/*
+ * Apply n edits and reparse only the statements they affect; edits close
+ * together are covered by one reparse.  The edits are sorted by start,
+ * do not overlap, and all refer to the text as it was before the call.
+ * Offsets are clamped to the document.  Returns 0, or -1 (and changes
+ * nothing) if the edits are out of order or overlap.
+ */
+int document_apply(struct document *d, struct parser *p,
+                   const struct doc_edit *edits, int n);
+
+/* One edit: replace bytes [start, end) with text[0 .. len) */
+void document_edit(struct document *d, struct parser *p,
+                   size_t start, size_t end, const char *text, size_t len);
+
+/* Segment i (0 .. nsegs - 1) */
+struct segment document_segment(const struct document *d, int i);
+
+/* Byte at offset off (< len) */
+static inline char document_byte(const struct document *d, size_t off) {
+    return d->buf[off < d->gap ? off : off + d->gap_len];
+}
+
+/* The whole text, contiguous and NUL-terminated (closes the gap) */
+const char *document_text(struct document *d);
+
+/* Byte offset of the start of line (1-based), or the text length */
+size_t document_line_start(const struct document *d, int line);
+
+void document_free(struct document *d);
+
+#endif /* DOCUMENT_H */
@@ -0,0 +1,39 @@
+/*
+ * events.c - Parse events (see events.h)
+ */
+
+#include "events.h"
+
+void event_enter(struct parser *p, const struct event *e) {
+    if (p->visitor->enter)
+        p->visitor->enter(p->visitor->ctx, e);
+}
+
+void event_exit(struct parser *p, const struct event *e) {
+    if (p->visitor->exit)
+        p->visitor->exit(p->visitor->ctx, e);
+}
+
+void event_seen(struct parser *p, const struct event *e) {
+    event_enter(p, e);
+    event_exit(p, e);
+}
+
+const char *event_name(enum event_kind kind) {
+    static const char *const names[EVENT_KINDS] = {
+        [EVENT_DECL]       = "decl",
+        [EVENT_IF]         = "if",
+        [EVENT_DO_WHILE]   = "do-while",
+        [EVENT_WHILE]      = "while",
+        [EVENT_FOR]        = "for",
+        [EVENT_SWITCH]     = "switch",
+        [EVENT_BLOCK]      = "block",
+        [EVENT_EXPR_STMT]  = "expr-stmt",
+        [EVENT_BREAK]      = "break",
+        [EVENT_DECLARATOR] = "declarator",
+        [EVENT_OPERATOR]   = "operator",
+        [EVENT_NAME]       = "name",
+        [EVENT_LITERAL]    = "literal",
+    };
+    return (unsigned) kind < EVENT_KINDS ? names[kind] : "?";
+}
@@ -0,0 +1,89 @@
+/*
+ * events.h - Parse events, for consumers that need no tree
+ *
+ * A parser with a visitor reports each construct from Bison's
+ * reduction actions as it recognizes it, and keeps nothing once it has:
+ * with parser_parse_fd() a consumer that counts constructs or checks a
+ * property of each one works in memory proportional to the nesting
+ * depth, however long the stream.
+ *
+ * The parser is bottom-up, so a construct is known only once its last
+ * token has been seen.  Statements that begin with a keyword or a
+ * brace (declaration, if, do-while, while, for, switch, block) are the
+ * exception: the first token says what they are, so their enter event
+ * comes with it, before the events of their parts, and their exit when
+ * they end.  Everything else (expression statements, break,
+ * declarators, operators, names, literals) gets its enter and exit
+ * together once it is complete, after the events of its parts: an
+ * expression's events are in postfix order, an operator after its
+ * operands.
+ *
+ * Events come from the Bison parser only: rd.c fires none.  After a
+ * syntax error the statements still open get no exit event.
+ *
+ * With lazy_blocks set, each block's body is skipped instead (the
+ * scanner finds the matching '}', see braces.h): its BLOCK events come
+ * with skipped set and body the range of its statements, which
+ * parser_parse_body() parses, with their events, whenever a consumer
+ * wants them.
+ */
+
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include "number.h"
+#include "parser.h"
+
+enum event_kind {
+    /* ── Statements ── */
+    EVENT_DECL,         /* int a, b = 1;                              */
+    EVENT_IF,           /* if (...) stmt [else stmt]                  */
+    EVENT_DO_WHILE,     /* do stmt while (...);                       */
+    EVENT_WHILE,        /* a1: while (...) stmt                       */
+    EVENT_FOR,          /* a1: for (...; ...; ...) stmt               */
+    EVENT_SWITCH,       /* a1: switch (...) { case ...: ... }         */
+    EVENT_BLOCK,        /* { ... }                                    */
+    EVENT_EXPR_STMT,    /* a = ...;  a += ...;  a++;  expr;           */
+    EVENT_BREAK,        /* a1: break;                                 */
+
+    /* ── Within them ── */
+    EVENT_DECLARATOR,   /* one name declared, after its initializer   */
+    EVENT_OPERATOR,     /* after its operands                         */
+    EVENT_NAME,         /* a variable as an operand                   */
+    EVENT_LITERAL,      /* a number                                   */
+
+    EVENT_KINDS
+};
+
+struct event {
+    enum event_kind kind;
+    struct span     span;     /* in the input: the whole construct,
+                                 or its first token for an early enter */
+    const char     *name;     /* DECLARATOR, NAME, the variable of an
+                                 EXPR_STMT, "[]", "++" or "--"         */
+    const char     *op;       /* OPERATOR, EXPR_STMT: "+", "<=", "!",
+                                 "[]", "+=", ...; unary minus is "-"   */
+    int             operands; /* OPERATOR: the expressions just before
+                                 it that it applies to                 */
+    struct number   value;    /* LITERAL                               */
+    struct span     body;     /* BLOCK: between its braces             */
+    int             skipped;  /* BLOCK: body not parsed (lazy_blocks)  */
+};
+
+/* Both callbacks may be NULL.  An event and its strings are valid only
+   during the call. */
+struct visitor {
+    void  (*enter)(void *ctx, const struct event *e);
+    void  (*exit)(void *ctx, const struct event *e);
+    void   *ctx;
+};
+
+/* Fired by parser.y's actions */
+void event_enter(struct parser *p, const struct event *e);
+void event_exit(struct parser *p, const struct event *e);
+void event_seen(struct parser *p, const struct event *e); /* enter+exit */
+
+/* "decl", "if", ..., "literal" */
+const char *event_name(enum event_kind kind);
+
+#endif /* EVENTS_H */
@@ -0,0 +1,246 @@
+/*
+ * exprs.c - Hash-consed expressions (see exprs.h)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "exprs.h"
+#include "strbuf.h"
+
+/* items, which holds *cap of size bytes, with room for n */
+static void *grow(void *items, size_t size, size_t n, size_t *cap) {
+    if (n <= *cap)
+        return items;
+    while (n > *cap)
+        *cap = *cap ? 2 * *cap : 64;
+    items = xrealloc(items, *cap * size);
+    return items;
+}
+
+/* FNV-1a, over a string or over the words of a key */
+#define FNV_BASIS 2166136261u
+#define FNV_PRIME 16777619u
+
+static uint32_t hash_text(const char *s) {
+    uint32_t h = FNV_BASIS;
+    while (*s) {
+        h ^= (unsigned char) *s++;
+        h *= FNV_PRIME;
+    }
+    return h;
+}
+
+static uint32_t mix(uint32_t h, uint64_t word) {
+    for (int i = 0; i < 8; i++, word >>= 8) {
+        h ^= (uint32_t) (word & 0xff);
+        h *= FNV_PRIME;
+    }
+    return h;
+}
+
+/* A new table of n slots, all empty */
+static uint32_t *new_table(size_t n) {
+    uint32_t *t = xmalloc(n * sizeof *t);
+    memset(t, 0xff, n * sizeof *t);     /* EXPRS_NONE */
+    return t;
+}
+
+/* ================================================================
+   Identifiers and operators
+   ================================================================ */
+static void grow_texts(struct expr_store *s) {
+    size_t n = s->text_slots ? 2 * s->text_slots : 64;
+    uint32_t *table = new_table(n);
+
+    for (uint32_t id = 0; id < s->ntexts; id++) {
+        size_t i = hash_text(s->texts[id]) & (n - 1);
+        while (table[i] != EXPRS_NONE)
+            i = (i + 1) & (n - 1);
+        table[i] = id;
+    }
+    free(s->text_table);
+    s->text_table = table;
+    s->text_slots = n;
+}
+
+/* The identifier ID of text, made if it has none yet */
+static uint32_t text_id(struct expr_store *s, const char *text) {
+    size_t i;
+
+    if (2 * ((size_t) s->ntexts + 1) > s->text_slots)
+        grow_texts(s);
+    i = hash_text(text) & (s->text_slots - 1);
+    while (s->text_table[i] != EXPRS_NONE) {
+        if (strcmp(s->texts[s->text_table[i]], text) == 0)
+            return s->text_table[i];
+        i = (i + 1) & (s->text_slots - 1);
+    }
+
+    s->texts = grow(s->texts, sizeof *s->texts, (size_t) s->ntexts + 1,
+                    &s->texts_cap);
+    s->texts[s->ntexts] = xstrdup(text);
+    s->text_table[i] = s->ntexts;
+    return s->ntexts++;
+}
+
+/* ================================================================
+   Nodes
+   ================================================================ */
+
+/* A literal's value as one word: the bits of its int or double */
+static uint64_t value_bits(const struct number *v) {
+    uint64_t bits;
+
+    if (v->kind == NUMBER_INT)
+        return (uint64_t) v->i;
+    memcpy(&bits, &v->f, sizeof bits);
+    return bits;
+}
+
+static uint32_t hash_node(const struct expr_node *n, const uint32_t *kids) {
+    uint32_t h = mix(FNV_BASIS, (uint64_t) n->kind << 32 | n->op);
+
+    h = mix(h, (uint64_t) n->name << 32 | n->nkids);
+    if (n->kind == EXPR_LITERAL)
+        h = mix(mix(h, (uint64_t) n->value.kind << 1 | !!n->value.overflow),
+                value_bits(&n->value));
+    for (uint32_t i = 0; i < n->nkids; i++)
+        h = mix(h, kids[i]);
+    return h;
+}
+
+static int same(const struct expr_store *s, const struct expr_node *a,
+                const struct expr_node *key, const uint32_t *kids) {
+    if (a->hash != key->hash || a->kind != key->kind || a->op != key->op ||
+        a->name != key->name || a->nkids != key->nkids)
+        return 0;
+    if (a->kind == EXPR_LITERAL &&
+        (a->value.kind != key->value.kind ||
+         !a->value.overflow != !key->value.overflow ||
+         value_bits(&a->value) != value_bits(&key->value)))
+        return 0;
+    return a->nkids == 0 ||
+           memcmp(s->kids + a->kids, kids, a->nkids * sizeof *kids) == 0;
+}
+
+static void grow_nodes(struct expr_store *s) {
+    size_t n = s->nslots ? 2 * s->nslots : 1024;
+    uint32_t *table = new_table(n);
+
+    for (uint32_t id = 0; id < s->count; id++) {
+        size_t i = s->nodes[id].hash & (n - 1);
+        while (table[i] != EXPRS_NONE)
+            i = (i + 1) & (n - 1);
+        table[i] = id;
+    }
+    free(s->table);
+    s->table = table;
+    s->nslots = n;
+}
+
+/* The ID of the node key describes, with kids[0 .. key->nkids), made
+   if there is none yet */
+static uint32_t node_id(struct expr_store *s, struct expr_node *key,
+                        const uint32_t *kids) {
+    size_t i;
+
+    if (2 * ((size_t) s->count + 1) > s->nslots)
+        grow_nodes(s);
+    key->hash = hash_node(key, kids);
+    i = key->hash & (s->nslots - 1);
+    while (s->table[i] != EXPRS_NONE) {
+        if (same(s, &s->nodes[s->table[i]], key, kids))
+            return s->table[i];
+        i = (i + 1) & (s->nslots - 1);
+    }
+    if (s->count == EXPRS_NONE)
+        out_of_memory();            /* no more IDs */
+
+    /* kids may be on the stack, which this does not move */
+    s->nodes = grow(s->nodes, sizeof *s->nodes, (size_t) s->count + 1,
+                    &s->cap);
+    key->kids = (uint32_t) s->nkids;
+    if (key->nkids) {
+        s->kids = grow(s->kids, sizeof *s->kids, s->nkids + key->nkids,
+                       &s->kids_cap);
+        memcpy(s->kids + s->nkids, kids, key->nkids * sizeof *kids);
+        s->nkids += key->nkids;
+    }
+
+    s->nodes[s->count] = *key;
+    s->table[i] = s->count;
+    return s->count++;
+}
+
+/* ================================================================
+   Events
+   ================================================================ */
+uint32_t exprs_add(struct expr_store *s, const struct event *e) {
+    struct expr_node key = { .op = EXPRS_NONE, .name = EXPRS_NONE };
+    const uint32_t *kids = NULL;
+    uint32_t id;
+
+    switch (e->kind) {
+    case EVENT_NAME:
+        key.kind = EXPR_NAME;
+        key.name = text_id(s, e->name);
+        break;
+    case EVENT_LITERAL:
+        key.kind  = EXPR_LITERAL;
+        key.value = e->value;
+        break;
+    case EVENT_OPERATOR:
+        key.kind = EXPR_OPERATOR;
+        key.op   = text_id(s, e->op);
+        if (e->name)
+            key.name = text_id(s, e->name);
+        /* its operands are the last expressions reported; after a
+           syntax error there may be fewer, and the expression is not
+           one: drop it and what is left of it */
+        if ((size_t) e->operands > s->depth) {
+            s->depth = 0;
+            return EXPRS_NONE;
+        }
+        key.nkids = (uint32_t) e->operands;
+        s->depth -= key.nkids;
+        kids = s->stack + s->depth;
+        break;
+    default:
+        /* a statement or declarator: its expressions are complete */
+        s->depth = 0;
+        return EXPRS_NONE;
+    }
+
+    id = node_id(s, &key, kids);
+    s->stack = grow(s->stack, sizeof *s->stack, s->depth + 1,
+                    &s->stack_cap);
+    s->stack[s->depth++] = id;
+    s->seen++;
+    return id;
+}
+
+static void add_event(void *ctx, const struct event *e) {
+    exprs_add(ctx, e);
+}
+
+struct visitor exprs_visitor(struct expr_store *s) {
+    return (struct visitor) { .exit = add_event, .ctx = s };
+}
+
+double exprs_dedup(const struct expr_store *s) {
+    return s->count ? (double) s->seen / s->count : 1;
+}
+
+void exprs_free(struct expr_store *s) {
+    for (uint32_t i = 0; i < s->ntexts; i++)
+        free(s->texts[i]);
+    free(s->texts);
+    free(s->text_table);
+    free(s->nodes);
+    free(s->kids);
+    free(s->table);
+    free(s->stack);
+    memset(s, 0, sizeof *s);
+}
@@ -0,0 +1,107 @@
+/*
+ * exprs.h - Hash-consed expressions, built from parse events
+ *
+ * Generated code says the same thing many times over: a + d * 2,
+ * i < 10, the same subscripts again and again.  An expr_store keeps
+ * one node per distinct expression, so an analysis that memoizes on a
+ * node's ID does its work once per distinct subexpression instead of
+ * once per occurrence.
+ *
+ * The store builds nothing the parser does not report (events.h): an
+ * expression's events come in postfix order, so a stack of node IDs is
+ * all it takes.  A name or a literal pushes its leaf; an operator pops
+ * its operands and pushes the node made of them.  Every node is found
+ * through an open-addressing hash table keyed on what it is made of
+ *
+ *     (operator, its variable if any, child IDs)    an operator
+ *     (identifier ID)                               a name
+ *     (value)                                       a literal
+ *
+ * and made only if it is not there yet.  Children are made before
+ * their parents, and nodes are numbered from 0 in the order they are
+ * made, so an ID means the same expression for as long as the store
+ * lives, across parses.  Parentheses make no node: (a) is a.
+ */
+
+#ifndef EXPRS_H
+#define EXPRS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "events.h"
+
+#define EXPRS_NONE UINT32_MAX
+
+enum expr_kind { EXPR_NAME, EXPR_LITERAL, EXPR_OPERATOR };
+
+struct expr_node {
+    enum expr_kind  kind;
+    uint32_t        op;       /* OPERATOR: "+", "<=", "[]", ... (an
+                                 identifier ID, see exprs_text())     */
+    uint32_t        name;     /* NAME; the variable of "[]", "++" and
+                                 "--"; else EXPRS_NONE                */
+    struct number   value;    /* LITERAL                              */
+    uint32_t        nkids;    /* OPERATOR: its operands, in order,    */
+    uint32_t        kids;     /*   at the store's kids[kids ..]       */
+    uint32_t        hash;
+};
+
+/* Zero-initialised */
+struct expr_store {
+    struct expr_node *nodes;    /* by ID                            */
+    uint32_t          count;    /* distinct expressions             */
+    size_t            cap;
+    uint32_t         *kids;     /* the children of every operator   */
+    size_t            nkids, kids_cap;
+    uint32_t         *table;    /* node IDs, EXPRS_NONE if empty    */
+    size_t            nslots;   /* a power of two                   */
+
+    char            **texts;    /* identifier and operator text, by
+                                   identifier ID                    */
+    uint32_t          ntexts;
+    size_t            texts_cap;
+    uint32_t         *text_table;
+    size_t            text_slots;
+
+    uint32_t         *stack;    /* the expressions not yet operands */
+    size_t            depth, stack_cap;
+    size_t            seen;     /* expressions reported, with repeats */
+};
+
+/*
+ * Take one exit event: returns the ID of the expression it completes
+ * (an operator, name or literal), or EXPRS_NONE for any other.  The
+ * end of a statement or declarator drops what is left on the stack.
+ * An operator with fewer operands on the stack than it takes (after a
+ * syntax error) is not stored either: it empties the stack and returns
+ * EXPRS_NONE.  Exits on out-of-memory.
+ */
+uint32_t exprs_add(struct expr_store *s, const struct event *e);
+
+/* A visitor that feeds the store, for parser.visitor */
+struct visitor exprs_visitor(struct expr_store *s);
+
+static inline const struct expr_node *exprs_node(const struct expr_store *s,
+                                                 uint32_t id) {
+    return &s->nodes[id];
+}
+
+/* The i-th operand of an operator */
+static inline uint32_t exprs_kid(const struct expr_store *s,
+                                 const struct expr_node *n, uint32_t i) {
+    return s->kids[n->kids + i];
+}
+
+/* The text of an identifier ID */
+static inline const char *exprs_text(const struct expr_store *s,
+                                     uint32_t id) {
+    return s->texts[id];
+}
+
+/* Expressions reported per distinct one (1 if none were) */
+double exprs_dedup(const struct expr_store *s);
+
+void exprs_free(struct expr_store *s);
+
+#endif /* EXPRS_H */
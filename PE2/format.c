@@ -0,0 +1,225 @@
+/*
+ * format.c - Verdict output: text, JSON Lines or SARIF (see format.h)
+ *
+ * Structured output is built in one reusable buffer and written to
+ * stdout with write() whenever it passes FLUSH_BYTES, so a file with
+ * thousands of diagnostics costs a few system calls rather than a
+ * locked stdio call per field.  Numbers and strings are appended
+ * directly; nothing is allocated once the buffer has grown.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "format.h"
+
+#define FLUSH_BYTES (64 * 1024)
+
+#define SARIF_HEAD \
+    "{\"version\":\"2.1.0\"," \
+    "\"$schema\":\"https://json.schemastore.org/sarif-2.1.0.json\"," \
+    "\"runs\":[{\"tool\":{\"driver\":{\"name\":\"c_parser\",\"rules\":[" \
+    "{\"id\":\"parse-error\",\"shortDescription\":" \
+    "{\"text\":\"The file is not a valid program\"}}," \
+    "{\"id\":\"read-error\",\"shortDescription\":" \
+    "{\"text\":\"The file could not be read\"}}]}}," \
+    "\"results\":[\n"
+#define SARIF_TAIL "]}]}\n"
+
+int format_parse(const char *name) {
+    if (strcmp(name, "text") == 0)
+        return FORMAT_TEXT;
+    if (strcmp(name, "jsonl") == 0)
+        return FORMAT_JSONL;
+    if (strcmp(name, "sarif") == 0)
+        return FORMAT_SARIF;
+    return -1;
+}
+
+/* ================================================================
+   Appending
+   ================================================================ */
+
+static void put(struct strbuf *out, const char *s) {
+    strbuf_add(out, s, strlen(s));
+}
+
+static void put_int(struct strbuf *out, int n) {
+    char buf[12], *p = buf + sizeof buf;
+    unsigned u = n < 0 ? 0u - (unsigned) n : (unsigned) n;
+
+    do
+        *--p = (char) ('0' + u % 10);
+    while ((u /= 10) != 0);
+    if (n < 0)
+        *--p = '-';
+    strbuf_add(out, p, (size_t) (buf + sizeof buf - p));
+}
+
+static void put_str(struct strbuf *out, const char *s) {
+    strbuf_add_json(out, s, strlen(s));
+}
+
+/* path as a URI: percent-encoded, every byte but the unreserved ones
+   and '/' (RFC 3986), so that a ':' or '%' in it cannot be misread;
+   file:// before an absolute path, "stdin:" for standard input */
+static void put_uri(struct strbuf *out, const char *path) {
+    static const char hex[] = "0123456789ABCDEF";
+
+    put(out, "\"");
+    if (strcmp(path, REPORT_STDIN) == 0) {
+        put(out, "stdin:\"");
+        return;
+    }
+    if (path[0] == '/')
+        put(out, "file://");
+    for (const unsigned char *s = (const unsigned char *) path; *s; s++) {
+        if ((*s >= 'a' && *s <= 'z') || (*s >= 'A' && *s <= 'Z') ||
+            (*s >= '0' && *s <= '9') || strchr("-._~/", *s)) {
+            strbuf_add(out, s, 1);
+        } else {
+            char esc[3] = { '%', hex[*s >> 4], hex[*s & 15] };
+            strbuf_add(out, esc, 3);
+        }
+    }
+    put(out, "\"");
+}
+
+/* "token", "kind" and "expected" of a diagnostic, after lead; kind
+   and expected only when there is a token kind */
+static void put_token(struct strbuf *out, const char *lead,
+                      const struct diag *d) {
+    put(out, lead);
+    put(out, "\"token\":");
+    put_str(out, d->token);
+    if (!d->kind)
+        return;
+    put(out, ",\"kind\":");
+    put_str(out, d->kind);
+    put(out, ",\"expected\":[");
+    for (int i = 0; i < d->nexpected; i++) {
+        if (i)
+            put(out, ",");
+        put_str(out, d->expected[i]);
+    }
+    put(out, "]");
+}
+
+/* ================================================================
+   Formats
+   ================================================================ */
+
+static void text_verdict(const char *path, const struct verdict *v) {
+    if (v->status == 2) {
+        fprintf(stderr, "%s: %s\n", path, strerror(v->error));
+    } else if (v->status == 0) {
+        printf("%s: Syntax valid.\n", path);
+    } else {
+        for (int i = 0; i < v->ndiags; i++)
+            fprintf(stderr, "%s: %s\n", path, v->diags[i].message);
+    }
+}
+
+static void jsonl_verdict(struct strbuf *out, const char *path,
+                          const struct verdict *v) {
+    if (v->status == 2) {
+        put(out, "{\"file\":");
+        put_str(out, path);
+        put(out, ",\"severity\":\"error\",\"message\":");
+        put_str(out, strerror(v->error));
+        put(out, "}\n");
+    }
+    for (int i = 0; v->status == 1 && i < v->ndiags; i++) {
+        const struct diag *d = &v->diags[i];
+        put(out, "{\"file\":");
+        put_str(out, path);
+        put(out, ",\"line\":");
+        put_int(out, d->line);
+        if (d->column > 0) {
+            put(out, ",\"column\":");
+            put_int(out, d->column);
+        }
+        put(out, ",\"severity\":\"error\",\"message\":");
+        put_str(out, d->message);
+        put_token(out, ",", d);
+        put(out, "}\n");
+    }
+}
+
+static void sarif_result(struct report *r, const char *rule,
+                         const char *message, const char *path,
+                         const struct diag *d) {
+    struct strbuf *out = &r->out;
+
+    if (r->results++)
+        put(out, ",\n");
+    put(out, "{\"ruleId\":\"");
+    put(out, rule);
+    put(out, "\",\"level\":\"error\",\"message\":{\"text\":");
+    put_str(out, message);
+    put(out, "},\"locations\":[{\"physicalLocation\":"
+             "{\"artifactLocation\":{\"uri\":");
+    put_uri(out, path);
+    put(out, "}");
+    if (d) {
+        put(out, ",\"region\":{\"startLine\":");
+        put_int(out, d->line);
+        if (d->column > 0) {
+            put(out, ",\"startColumn\":");
+            put_int(out, d->column);
+        }
+        put(out, "}");
+    }
+    put(out, "}}]");
+    if (d) {
+        put_token(out, ",\"properties\":{", d);
+        put(out, "}");
+    }
+    put(out, "}");
+}
+
+/* ================================================================
+   Public interface
+   ================================================================ */
+
+static void flush(struct report *r) {
+    fflush(stdout);     /* nothing of ours is in there; keep order */
+    strbuf_write_fd(&r->out, STDOUT_FILENO);
+    strbuf_reset(&r->out);
+}
+
+void report_begin(struct report *r, enum format format) {
+    *r = (struct report) { .format = format };
+    if (format == FORMAT_SARIF)
+        put(&r->out, SARIF_HEAD);
+}
+
+void report_verdict(struct report *r, const char *path,
+                    const struct verdict *v) {
+    switch (r->format) {
+    case FORMAT_TEXT:
+        text_verdict(path, v);
+        return;
+    case FORMAT_JSONL:
+        jsonl_verdict(&r->out, path, v);
+        break;
+    case FORMAT_SARIF:
+        if (v->status == 2)
+            sarif_result(r, "read-error", strerror(v->error), path, NULL);
+        for (int i = 0; v->status == 1 && i < v->ndiags; i++)
+            sarif_result(r, "parse-error", v->diags[i].message, path,
+                         &v->diags[i]);
+        break;
+    }
+    if (r->out.len >= FLUSH_BYTES)
+        flush(r);
+}
+
+void report_end(struct report *r) {
+    if (r->format == FORMAT_SARIF)
+        put(&r->out, r->results ? "\n" SARIF_TAIL : SARIF_TAIL);
+    if (r->out.len)
+        flush(r);
+    strbuf_free(&r->out);
+}
@@ -0,0 +1,44 @@
+/*
+ * format.h - Verdict output: text, JSON Lines or SARIF (--format)
+ *
+ * Text is what c_parser has always printed: "path: Syntax valid." on
+ * stdout and each diagnostic, prefixed by the path, on stderr.  The
+ * structured formats put everything on stdout, one diagnostic at a
+ * time, with its file, line, column, token text, token kind and the
+ * tokens the parser expected there:
+ *
+ *   jsonl   one JSON object per diagnostic and per unreadable file;
+ *           valid files print nothing
+ *   sarif   one SARIF 2.1.0 log with a result per diagnostic
+ */
+
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include "diag.h"
+#include "strbuf.h"
+
+enum format { FORMAT_TEXT, FORMAT_JSONL, FORMAT_SARIF };
+
+/* "text", "jsonl" or "sarif"; -1 for anything else */
+int format_parse(const char *name);
+
+struct report {
+    enum format     format;
+    struct strbuf   out;        /* structured output not yet written */
+    int             results;    /* written so far (SARIF)            */
+};
+
+void report_begin(struct report *r, enum format format);
+
+/* The path that names standard input (SARIF gives it the URI "stdin:") */
+#define REPORT_STDIN "<stdin>"
+
+/* One file's verdict (v->file is not used; path names the file) */
+void report_verdict(struct report *r, const char *path,
+                    const struct verdict *v);
+
+/* Write what is left (and close the SARIF log) */
+void report_end(struct report *r);
+
+#endif /* FORMAT_H */
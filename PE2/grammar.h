@@ -0,0 +1,89 @@
+/*
+ * grammar.h - One dialect's generated parser, as parser.c sees it
+ *
+ * parser.y and lexer.l are the source of every dialect: dialect.awk
+ * cuts out each one's grammar and scanner, and Bison and flex build
+ * them with a prefix of their own (pe2_yy, a1_yy), so their tables sit
+ * side by side in one binary.  Each exports a struct grammar; parser.c
+ * dispatches through the one a parser instance was set to and keeps
+ * everything that does not depend on the tables.
+ */
+
+#ifndef GRAMMAR_H
+#define GRAMMAR_H
+
+#include <stddef.h>
+
+#include "parser.h"
+
+struct token_buf;
+
+struct grammar {
+    const char  *name;      /* as given to --dialect=               */
+    int          ntokens;   /* symbol kinds of tokens, for --stats  */
+    int          nrules;    /* rules, numbered as in its .output    */
+
+    /* The scanner (a yyscan_t with p as its extra data) */
+    int        (*scanner_new)(struct parser *p, void **scanner);
+    void       (*scanner_free)(void *scanner);
+
+    /* Parse buf[0..len), followed by two NULs: 0 if valid, 1 on a
+       syntax error, -1 if the scanner could not take the buffer */
+    int        (*parse)(struct parser *p, char *buf, size_t len);
+
+    /* Parse what can be read from p->stream_fd, as above (see
+       parser_parse_fd()) */
+    int        (*parse_stream)(struct parser *p);
+
+    /* Parse the tokens in p->ahead, as above */
+    int        (*parse_ahead)(struct parser *p);
+
+    /* Scan tokens from the scanner's buffer into t (tokens.h) until it
+       is full or holds the end token */
+    void       (*scan_batch)(void *scanner, struct token_buf *t);
+
+    /* Scan buf[0..len), followed by two NULs, with a scanner of its
+       own, for tokens.c: tokens, located from base, go to the list t a
+       batch at a time, without the end token, for as long as more()
+       returns non-zero.  -1 if the scanner could not take the buffer.
+       With buf NULL the scanner reads its parser's stream_src instead,
+       into a buffer of its own. */
+    int        (*scan)(void *scanner, char *buf, size_t len, size_t base,
+                       struct token_buf *t,
+                       int (*more)(void *ctx, struct token_buf *t),
+                       void *ctx);
+
+    /* The token being scanned: its text and its offset in the buffer */
+    const char *(*token_text)(void *scanner);
+    size_t     (*token_start)(void *scanner);
+
+    /* The byte after the token being scanned is a NUL in the buffer
+       for now: put back the byte it was (0) or the NUL again (1) */
+    void       (*hold)(void *scanner, int nul);
+
+    /* Streamed input: the line (from 0) and column (from 1, 0 if its
+       line began before the scanner's buffer) of an offset in it */
+    void       (*stream_position)(void *scanner, size_t offset,
+                                  int *line, int *column);
+
+    /* With the scanner just past a '{', skip to the '}' that closes it
+       (lazy_blocks) and set *close to its offset: 0 if it cannot */
+    int        (*skip_block)(void *scanner, size_t *close);
+
+    /* Names of symbol kinds and rules */
+    const char *(*token_name)(int kind);
+    const char *(*rule_name)(int rule);
+};
+
+extern const struct grammar pe2_grammar;
+extern const struct grammar a1_grammar;
+
+/* Text of the token being scanned (or last taken from p->ahead) */
+const char *parser_token_text(struct parser *p);
+
+/* Report a syntax error at the token that starts at offset, of the
+   given kind (-1 if none) where expected[] would have been accepted */
+void parser_syntax_error(struct parser *p, size_t offset, int kind,
+                         const int *expected, int nexpected);
+
+#endif /* GRAMMAR_H */
@@ -0,0 +1,40 @@
+/*
+ * ingest.h - Batched reading of many input files
+ *
+ * Keeps up to depth files in flight and hands them out, in the order
+ * given, as padded buffers ready for parser_parse_buffer().  Reads go
+ * through io_uring where the kernel allows it, else open/read/close.
+ */
+
+#ifndef INGEST_H
+#define INGEST_H
+
+#include <stddef.h>
+
+struct ingest_file {
+    const char *path;
+    int         index;      /* position in the path list             */
+    int         error;      /* errno if the file could not be read   */
+    char       *data;       /* text, followed by two NUL bytes       */
+    size_t      len;
+};
+
+struct ingest;
+
+/* Read paths[0 .. n); use_uring 0 forces the open/read/close path.
+   The paths must stay valid until ingest_free(). */
+struct ingest *ingest_new(const char *const *paths, int n, int depth,
+                          int use_uring);
+
+/* The next file, or NULL when all have been handed out.  Its buffer
+   belongs to the caller until ingest_release(); at most depth files
+   can be held at once. */
+struct ingest_file *ingest_next(struct ingest *in);
+void ingest_release(struct ingest *in, struct ingest_file *f);
+
+/* 1 if reads are going through io_uring */
+int ingest_uring(const struct ingest *in);
+
+void ingest_free(struct ingest *in);
+
+#endif /* INGEST_H */
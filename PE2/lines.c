@@ -0,0 +1,98 @@
+/*
+ * lines.c - Line and column numbers from byte offsets (see lines.h)
+ */
+
+#include <stdlib.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "lines.h"
+#include "strbuf.h"
+
+/* Scan at least this far past an offset, so that the diagnostics that
+   follow an error do not each rescan a few bytes */
+#define SCAN_AHEAD  (64 * 1024)
+
+static void add_start(struct line_table *t, size_t start) {
+    if (t->n == t->cap) {
+        t->cap = t->cap ? 2 * t->cap : 1024;
+        t->starts = xrealloc(t->starts, t->cap * sizeof *t->starts);
+    }
+    t->starts[t->n++] = start;
+}
+
+/* Record the newlines in text[scanned .. end) */
+static void scan_to(struct line_table *t, size_t end) {
+    const char *s = t->text;
+    size_t i = t->scanned;
+
+#ifdef __SSE2__
+    /* one compare per 16 bytes; a set bit per newline */
+    const __m128i nl = _mm_set1_epi8('\n');
+    for (; i + 16 <= end; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (s + i));
+        unsigned mask = (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(v, nl));
+        while (mask) {
+            add_start(t, i + (size_t) __builtin_ctz(mask) + 1);
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (; i < end; i++)
+        if (s[i] == '\n')
+            add_start(t, i + 1);
+    t->scanned = end;
+}
+
+void lines_reset(struct line_table *t, const char *text, size_t len) {
+    t->text    = text;
+    t->len     = len;
+    t->scanned = 0;
+    t->n       = 0;
+}
+
+void lines_find(struct line_table *t, size_t offset, int *line, int *column) {
+    size_t lo = 0, hi;
+
+    if (offset > t->len)
+        offset = t->len;
+    if (offset > t->scanned)
+        scan_to(t, t->len - offset > SCAN_AHEAD ? offset + SCAN_AHEAD
+                                                : t->len);
+
+    /* lo = the number of lines that start at or before offset */
+    hi = t->n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (t->starts[mid] <= offset)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    *line   = (int) lo;
+    *column = (int) (offset - (lo ? t->starts[lo - 1] : 0)) + 1;
+}
+
+size_t lines_count(const char *s, size_t len) {
+    size_t i = 0, n = 0;
+
+#ifdef __SSE2__
+    const __m128i nl = _mm_set1_epi8('\n');
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (s + i));
+        n += (size_t) __builtin_popcount(
+            (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(v, nl)));
+    }
+#endif
+    for (; i < len; i++)
+        n += s[i] == '\n';
+    return n;
+}
+
+void lines_free(struct line_table *t) {
+    free(t->starts);
+    t->starts = NULL;
+    t->n = t->cap = 0;
+}
@@ -0,0 +1,38 @@
+/*
+ * lines.h - Line and column numbers from byte offsets
+ *
+ * The scanner tracks nothing but byte offsets: each token's location
+ * is where it starts and ends in the buffer.  Lines are only needed
+ * for diagnostics, so a line_table records where the buffer's newlines
+ * are the first time one is asked for, scanning 16 bytes at a time, and
+ * turns an offset into a line and column by binary search.  A parse
+ * with no diagnostics never scans for newlines at all.
+ */
+
+#ifndef LINES_H
+#define LINES_H
+
+#include <stddef.h>
+
+struct line_table {
+    const char *text;       /* the buffer being parsed                */
+    size_t      len;
+    size_t      scanned;    /* newlines before this offset are known  */
+    size_t     *starts;     /* offset of each line after the first    */
+    size_t      n;
+    size_t      cap;
+};
+
+/* Forget the newlines found so far and start over on text[0 .. len) */
+void lines_reset(struct line_table *t, const char *text, size_t len);
+
+/* The line (from 0) and column (from 1, in bytes) of offset */
+void lines_find(struct line_table *t, size_t offset, int *line, int *column);
+
+/* The newlines in s[0 .. len), for streamed input, which has no
+   table (parser_parse_fd()) */
+size_t lines_count(const char *s, size_t len);
+
+void lines_free(struct line_table *t);
+
+#endif /* LINES_H */
@@ -0,0 +1,523 @@
+/*
+ * lsp.c - Language Server Protocol front end (c_parser --lsp)
+ *
+ * Speaks JSON-RPC over stdin/stdout with the usual Content-Length
+ * framing and publishes syntax errors as diagnostics.  Each open file
+ * is a struct document: didChange edits are applied in place and only
+ * the top-level statements they touch are re-lexed and reparsed (see
+ * document.h), so the work per keystroke does not grow with the file.
+ *
+ * Supported: initialize, shutdown, exit, textDocument/didOpen,
+ * didChange (incremental or full text) and didClose.  Everything else
+ * is answered with MethodNotFound or, for notifications, ignored.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "document.h"
+#include "lsp.h"
+
+struct open_doc {
+    char            *uri;
+    struct document  doc;
+    struct open_doc *next;
+};
+
+/* ================================================================
+   Minimal JSON reader
+   Values are read in place from the message text: a "value" is a
+   pointer to its first character.
+   ================================================================ */
+
+static const char *json_ws(const char *s) {
+    while (*s == ' ' || *s == '\t' || *s == '\n' || *s == '\r')
+        s++;
+    return s;
+}
+
+/* Skip one value; NULL if malformed */
+static const char *json_skip(const char *s) {
+    s = json_ws(s);
+    if (*s == '"') {
+        for (s++; *s != '"'; s++) {
+            if (*s == '\0')
+                return NULL;
+            if (*s == '\\' && *++s == '\0')
+                return NULL;
+        }
+        return s + 1;
+    }
+    if (*s == '{' || *s == '[') {
+        char close = *s == '{' ? '}' : ']';
+        s = json_ws(s + 1);
+        if (*s == close)
+            return s + 1;
+        for (;;) {
+            if (close == '}') {
+                s = json_skip(s);               /* key */
+                if (!s || *(s = json_ws(s)) != ':')
+                    return NULL;
+                s++;
+            }
+            s = json_skip(s);
+            if (!s)
+                return NULL;
+            s = json_ws(s);
+            if (*s == close)
+                return s + 1;
+            if (*s != ',')
+                return NULL;
+            s++;
+        }
+    }
+    /* number, true, false, null */
+    const char *start = s;
+    while (*s && !strchr(" \t\r\n,]}", *s))
+        s++;
+    return s > start ? s : NULL;
+}
+
+/* Value of member key in object v, or NULL */
+static const char *json_get(const char *v, const char *key) {
+    size_t klen = strlen(key);
+
+    if (!v || *(v = json_ws(v)) != '{')
+        return NULL;
+    v = json_ws(v + 1);
+    while (*v == '"') {
+        const char *k = v + 1;
+        const char *end = json_skip(v);
+        if (!end || *(end = json_ws(end)) != ':')
+            return NULL;
+        const char *val = json_ws(end + 1);
+        if (strncmp(k, key, klen) == 0 && k[klen] == '"')
+            return val;
+        v = json_skip(val);
+        if (!v || *(v = json_ws(v)) != ',')
+            return NULL;
+        v = json_ws(v + 1);
+    }
+    return NULL;
+}
+
+/* First element of array v, or NULL */
+static const char *json_first(const char *v) {
+    if (!v || *(v = json_ws(v)) != '[')
+        return NULL;
+    v = json_ws(v + 1);
+    return *v == ']' ? NULL : v;
+}
+
+/* Element after elem, or NULL */
+static const char *json_next(const char *elem) {
+    const char *s = json_skip(elem);
+    if (!s || *(s = json_ws(s)) != ',')
+        return NULL;
+    return json_ws(s + 1);
+}
+
+static long json_int(const char *v, long dflt) {
+    char *end;
+    long n;
+
+    if (!v)
+        return dflt;
+    n = strtol(v, &end, 10);
+    return end > v ? n : dflt;
+}
+
+static void put_utf8(struct strbuf *out, unsigned long c) {
+    char b[4];
+    size_t n;
+
+    if (c < 0x80) {
+        b[0] = (char) c;
+        n = 1;
+    } else if (c < 0x800) {
+        b[0] = (char) (0xC0 | c >> 6);
+        b[1] = (char) (0x80 | (c & 0x3F));
+        n = 2;
+    } else if (c < 0x10000) {
+        b[0] = (char) (0xE0 | c >> 12);
+        b[1] = (char) (0x80 | (c >> 6 & 0x3F));
+        b[2] = (char) (0x80 | (c & 0x3F));
+        n = 3;
+    } else {
+        b[0] = (char) (0xF0 | c >> 18);
+        b[1] = (char) (0x80 | (c >> 12 & 0x3F));
+        b[2] = (char) (0x80 | (c >> 6 & 0x3F));
+        b[3] = (char) (0x80 | (c & 0x3F));
+        n = 4;
+    }
+    strbuf_add(out, b, n);
+}
+
+static unsigned long hex4(const char *s) {
+    char digits[5] = { 0 };
+    memcpy(digits, s, 4);
+    return strtoul(digits, NULL, 16);
+}
+
+/* Decode string value v into out (reset first); -1 if not a string */
+static int json_str(const char *v, struct strbuf *out) {
+    strbuf_reset(out);
+    if (!v || *(v = json_ws(v)) != '"' || !json_skip(v))
+        return -1;
+    for (v++; *v != '"'; v++) {
+        const char *run = v;
+        while (*v != '"' && *v != '\\')
+            v++;
+        strbuf_add(out, run, v - run);
+        if (*v == '"')
+            break;
+        switch (*++v) {
+        case 'b': strbuf_add(out, "\b", 1); break;
+        case 'f': strbuf_add(out, "\f", 1); break;
+        case 'n': strbuf_add(out, "\n", 1); break;
+        case 'r': strbuf_add(out, "\r", 1); break;
+        case 't': strbuf_add(out, "\t", 1); break;
+        case 'u': {
+            if (strspn(v + 1, "0123456789abcdefABCDEF") < 4)
+                return -1;
+            unsigned long c = hex4(v + 1);
+            v += 4;
+            if (c >= 0xD800 && c < 0xDC00 && v[1] == '\\' && v[2] == 'u' &&
+                strspn(v + 3, "0123456789abcdefABCDEF") >= 4) {
+                unsigned long lo = hex4(v + 3);
+                if (lo >= 0xDC00 && lo < 0xE000) {
+                    c = 0x10000 + ((c - 0xD800) << 10) + (lo - 0xDC00);
+                    v += 6;
+                }
+            }
+            put_utf8(out, c);
+            break;
+        }
+        default:  strbuf_add(out, v, 1); break;     /* " \ / */
+        }
+    }
+    strbuf_reserve(out, 1);
+    out->data[out->len] = '\0';
+    return 0;
+}
+
+/* ================================================================
+   Positions: LSP counts lines from 0 and columns in UTF-16 units
+   ================================================================ */
+
+static size_t utf8_len(unsigned char lead) {
+    return lead < 0xC0 ? 1 : lead < 0xE0 ? 2 : lead < 0xF0 ? 3 : 4;
+}
+
+/* Byte offset of a {line, character} position */
+static size_t position_offset(const struct document *d, const char *pos) {
+    long line = json_int(json_get(pos, "line"), 0);
+    long col  = json_int(json_get(pos, "character"), 0);
+    size_t at = document_line_start(d, (int) line + 1);
+
+    while (col > 0 && at < d->len && document_byte(d, at) != '\n') {
+        unsigned char c = (unsigned char) document_byte(d, at);
+        col -= c >= 0xF0 ? 2 : 1;       /* outside the BMP: a pair */
+        at  += utf8_len(c);
+    }
+    return at < d->len ? at : d->len;
+}
+
+/* Length of line (1-based) in UTF-16 units */
+static long line_width(const struct document *d, int line) {
+    size_t at = document_line_start(d, line);
+    long width = 0;
+
+    while (at < d->len && document_byte(d, at) != '\n') {
+        unsigned char c = (unsigned char) document_byte(d, at);
+        width += c >= 0xF0 ? 2 : 1;
+        at    += utf8_len(c);
+    }
+    return width;
+}
+
+/* ================================================================
+   Transport
+   ================================================================ */
+
+static struct strbuf in_buf;    /* bytes read from stdin, not yet used */
+static size_t        in_pos;
+
+static int write_full(int fd, const char *p, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        p   += n;
+        len -= (size_t) n;
+    }
+    return 0;
+}
+
+static void send_message(const struct strbuf *body) {
+    char header[64];
+    int n = snprintf(header, sizeof header,
+                     "Content-Length: %zu\r\n\r\n", body->len);
+    write_full(STDOUT_FILENO, header, (size_t) n);
+    write_full(STDOUT_FILENO, body->data, body->len);
+}
+
+/* Read more input; 0 at end of file */
+static int fill(void) {
+    if (in_pos > 0) {
+        memmove(in_buf.data, in_buf.data + in_pos, in_buf.len - in_pos);
+        in_buf.len -= in_pos;
+        in_pos = 0;
+    }
+    strbuf_reserve(&in_buf, 64 * 1024);
+    for (;;) {
+        ssize_t n = read(STDIN_FILENO, in_buf.data + in_buf.len,
+                         in_buf.cap - in_buf.len - 1);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return 0;
+        in_buf.len += (size_t) n;
+        return 1;
+    }
+}
+
+/* Next message body, NUL-terminated, or NULL at end of input */
+static char *read_message(void) {
+    static struct strbuf body;
+    size_t length = 0;
+    int have_length = 0;
+
+    /* Header lines up to an empty line */
+    for (;;) {
+        char *start = in_buf.data ? in_buf.data + in_pos : NULL;
+        char *eol = start ? memchr(start, '\n', in_buf.len - in_pos) : NULL;
+        if (!eol) {
+            if (!fill())
+                return NULL;
+            continue;
+        }
+        size_t n = (size_t) (eol - start);
+        in_pos += n + 1;
+        if (n > 0 && start[n - 1] == '\r')
+            n--;
+        if (n == 0) {
+            if (have_length)
+                break;
+            continue;
+        }
+        if (n > 15 && strncmp(start, "Content-Length:", 15) == 0) {
+            length = strtoul(start + 15, NULL, 10);
+            have_length = 1;
+        }
+    }
+
+    while (in_buf.len - in_pos < length)
+        if (!fill())
+            return NULL;
+    strbuf_reset(&body);
+    strbuf_add(&body, in_buf.data + in_pos, length);
+    strbuf_add(&body, "", 1);
+    in_pos += length;
+    return body.data;
+}
+
+/* ================================================================
+   Server
+   ================================================================ */
+
+struct server {
+    struct parser   *parser;
+    struct open_doc *docs;
+    struct strbuf    out;       /* outgoing message */
+    struct strbuf    str;       /* decoded JSON strings */
+    struct strbuf    text;      /* decoded document text */
+    int              shutdown;
+};
+
+static struct open_doc *find_doc(struct server *s, const char *uri) {
+    for (struct open_doc *d = s->docs; d; d = d->next)
+        if (strcmp(d->uri, uri) == 0)
+            return d;
+    return NULL;
+}
+
+static void reply(struct server *s, const char *id, const char *result) {
+    const char *end = json_skip(id);
+
+    strbuf_reset(&s->out);
+    strbuf_addf(&s->out, "{\"jsonrpc\":\"2.0\",\"id\":%.*s,\"result\":%s}",
+                (int) (end - id), id, result);
+    send_message(&s->out);
+}
+
+static void reply_error(struct server *s, const char *id,
+                        int code, const char *message) {
+    const char *end = json_skip(id);
+
+    strbuf_reset(&s->out);
+    strbuf_addf(&s->out, "{\"jsonrpc\":\"2.0\",\"id\":%.*s,"
+                "\"error\":{\"code\":%d,\"message\":\"%s\"}}",
+                (int) (end - id), id, code, message);
+    send_message(&s->out);
+}
+
+/* One diagnostic per error segment, with c_parser's own message */
+static void publish(struct server *s, const char *uri,
+                    const struct document *d) {
+    int first = 1;
+
+    strbuf_reset(&s->out);
+    strbuf_addf(&s->out, "{\"jsonrpc\":\"2.0\","
+                "\"method\":\"textDocument/publishDiagnostics\","
+                "\"params\":{\"uri\":");
+    strbuf_add_json(&s->out, uri, strlen(uri));
+    strbuf_addf(&s->out, ",\"diagnostics\":[");
+
+    for (int i = 0; d && i < d->nerrs; i++) {
+        const struct doc_error *e = &d->errs[i];
+        size_t len = strlen(e->diag);
+        while (len > 0 && e->diag[len - 1] == '\n')
+            len--;
+        strbuf_addf(&s->out, "%s{\"range\":{\"start\":{\"line\":%d,"
+                    "\"character\":0},\"end\":{\"line\":%d,"
+                    "\"character\":%ld}},\"severity\":1,"
+                    "\"source\":\"c_parser\",\"message\":",
+                    first ? "" : ",", e->err_line - 1,
+                    e->err_line - 1, line_width(d, e->err_line));
+        strbuf_add_json(&s->out, e->diag, len);
+        strbuf_addf(&s->out, "}");
+        first = 0;
+    }
+    strbuf_addf(&s->out, "]}}");
+    send_message(&s->out);
+}
+
+static void did_open(struct server *s, const char *params) {
+    const char *td = json_get(params, "textDocument");
+    struct open_doc *d;
+
+    if (json_str(json_get(td, "uri"), &s->str) < 0 ||
+        json_str(json_get(td, "text"), &s->text) < 0)
+        return;
+    d = find_doc(s, s->str.data);
+    if (!d) {
+        d = xcalloc(1, sizeof *d);
+        d->uri = xstrdup(s->str.data);
+        d->next = s->docs;
+        s->docs = d;
+    }
+    document_set(&d->doc, s->parser, s->text.data, s->text.len);
+    publish(s, d->uri, &d->doc);
+}
+
+static void did_change(struct server *s, const char *params) {
+    const char *td = json_get(params, "textDocument");
+    struct open_doc *d;
+
+    if (json_str(json_get(td, "uri"), &s->str) < 0 ||
+        !(d = find_doc(s, s->str.data)))
+        return;
+
+    /* Changes apply one after another, each to the previous result */
+    for (const char *c = json_first(json_get(params, "contentChanges"));
+         c; c = json_next(c)) {
+        const char *range = json_get(c, "range");
+        if (json_str(json_get(c, "text"), &s->text) < 0)
+            continue;
+        if (!range) {
+            document_set(&d->doc, s->parser, s->text.data, s->text.len);
+            continue;
+        }
+        size_t start = position_offset(&d->doc, json_get(range, "start"));
+        size_t end   = position_offset(&d->doc, json_get(range, "end"));
+        document_edit(&d->doc, s->parser, start, end,
+                      s->text.data, s->text.len);
+    }
+    publish(s, d->uri, &d->doc);
+}
+
+static void did_close(struct server *s, const char *params) {
+    const char *td = json_get(params, "textDocument");
+    struct open_doc **link;
+
+    if (json_str(json_get(td, "uri"), &s->str) < 0)
+        return;
+    for (link = &s->docs; *link; link = &(*link)->next) {
+        struct open_doc *d = *link;
+        if (strcmp(d->uri, s->str.data) == 0) {
+            *link = d->next;
+            publish(s, d->uri, NULL);           /* clear its markers */
+            document_free(&d->doc);
+            free(d->uri);
+            free(d);
+            return;
+        }
+    }
+}
+
+/* Handle one message; returns -1 to keep going, else the exit status */
+static int dispatch(struct server *s, const char *msg) {
+    const char *id = json_get(msg, "id");
+    const char *params = json_get(msg, "params");
+    const char *method;
+
+    if (json_str(json_get(msg, "method"), &s->str) < 0)
+        return -1;                              /* a response: ignore */
+    method = s->str.data;
+
+    if (strcmp(method, "initialize") == 0 && id) {
+        reply(s, id, "{\"capabilities\":{\"textDocumentSync\":"
+                     "{\"openClose\":true,\"change\":2}},"
+                     "\"serverInfo\":{\"name\":\"c_parser\"}}");
+    } else if (strcmp(method, "shutdown") == 0 && id) {
+        s->shutdown = 1;
+        reply(s, id, "null");
+    } else if (strcmp(method, "exit") == 0) {
+        return s->shutdown ? 0 : 1;
+    } else if (strcmp(method, "textDocument/didOpen") == 0) {
+        did_open(s, params);
+    } else if (strcmp(method, "textDocument/didChange") == 0) {
+        did_change(s, params);
+    } else if (strcmp(method, "textDocument/didClose") == 0) {
+        did_close(s, params);
+    } else if (id) {
+        reply_error(s, id, -32601, "Method not found");
+    }
+    return -1;
+}
+
+int lsp_main(enum dialect dialect) {
+    struct server s = { .parser = parser_new() };
+    char *msg;
+    int status = 1;         /* end of input without exit */
+
+    parser_set_dialect(s.parser, dialect);
+    while ((msg = read_message()) != NULL) {
+        int rc = dispatch(&s, msg);
+        if (rc >= 0) {
+            status = rc;
+            break;
+        }
+    }
+
+    while (s.docs) {
+        struct open_doc *d = s.docs;
+        s.docs = d->next;
+        document_free(&d->doc);
+        free(d->uri);
+        free(d);
+    }
+    parser_free(s.parser);
+    strbuf_free(&s.out);
+    strbuf_free(&s.str);
+    strbuf_free(&s.text);
+    strbuf_free(&in_buf);
+    return status;
+}
@@ -0,0 +1,14 @@
+/*
+ * lsp.h - Language Server Protocol front end (c_parser --lsp)
+ */
+
+#ifndef LSP_H
+#define LSP_H
+
+#include "parser.h"
+
+/* Serve requests on stdin/stdout until "exit", checking every document
+   in dialect; returns the exit status */
+int lsp_main(enum dialect dialect);
+
+#endif /* LSP_H */
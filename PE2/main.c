@@ -0,0 +1,253 @@
+/*
+ * main.c - c_parser command line
+ *
+ * Reads the whole program from stdin, parses it with one parser
+ * instance and prints the verdict:
+ *
+ *     ./c_parser [OPTIONS] [-j N] < file
+ *     ./c_parser [OPTIONS] [-j N] [--no-uring] file...
+ *     ./c_parser [OPTIONS] --count [--exprs] < stream
+ *     ./c_parser [--max-depth=N] --watch DIR
+ *     ./c_parser [--dialect=pe2|a1] --lsp
+ *
+ * OPTIONS are --stats, --max-depth=N, --format=text|jsonl|sarif and
+ * --dialect=pe2|a1, and for a1 also --parser=lalr|rd and --check-bounds.
+ *
+ * Given files, it checks each in turn and prefixes every line with the
+ * file name; they are read in batches through io_uring (see ingest.c)
+ * unless --no-uring asks for plain open/read/close.  -j N checks them
+ * on N threads, splitting large files (see check.c); with stdin it
+ * scans a large program on N threads before parsing it (see tokens.c).
+ * Otherwise a program of a megabyte or more on stdin is scanned on a
+ * second CPU while it is parsed, if there is one.
+ * --format=jsonl or sarif writes the diagnostics to stdout as JSON
+ * Lines or a SARIF log instead of text (see format.c).
+ * --dialect=a1 parses the Assignment 1 language (for, switch, arrays,
+ * ...) instead of PE2's; there --parser=rd uses the hand-written parser
+ * (rd.c) and --check-bounds rejects constant out-of-range subscripts.
+ * --count reads stdin a block at a time instead of whole, and prints
+ * how many of each construct it held (statements by kind, declarators,
+ * operators, names, literals) as the parser reports them (events.h):
+ * memory stays the same however long the stream.  --exprs also keeps
+ * each distinct expression once (see exprs.h) and prints how many there
+ * were and how often each recurred on average; memory then grows with
+ * the distinct expressions.
+ * --watch keeps validating the .c files under DIR as they change (see
+ * watch.c); --lsp runs a language server on stdin/stdout (see lsp.c).
+ *
+ * Exit status is 0 for a valid program, 1 for a syntax error and 2 for
+ * a usage or I/O error.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "check.h"
+#include "diag.h"
+#include "events.h"
+#include "exprs.h"
+#include "format.h"
+#include "lsp.h"
+#include "parser.h"
+#include "tokens.h"
+#include "watch.h"
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [OPTIONS] [-j N] < file\n"
+                    "       %s [OPTIONS] [-j N] [--no-uring] file...\n"
+                    "       %s [OPTIONS] --count [--exprs] < stream\n"
+                    "       %s [--max-depth=N] --watch DIR\n"
+                    "       %s [--dialect=pe2|a1] --lsp\n"
+                    "options: --stats  --max-depth=N  "
+                    "--format=text|jsonl|sarif  --dialect=pe2|a1\n"
+                    "  (a1)   --parser=lalr|rd  --check-bounds\n",
+            argv0, argv0, argv0, argv0, argv0);
+}
+
+struct counts {
+    long               kinds[EVENT_KINDS];
+    struct expr_store *exprs;           /* --exprs, else NULL */
+};
+
+static void count_event(void *ctx, const struct event *e) {
+    struct counts *c = ctx;
+
+    c->kinds[e->kind]++;
+    if (c->exprs)
+        exprs_add(c->exprs, e);
+}
+
+/* --count: parse stdin as a stream, counting the constructs that end */
+static int count_stream(struct parser *p, int exprs) {
+    struct expr_store store = { 0 };
+    struct counts c = { .exprs = exprs ? &store : NULL };
+    struct visitor v = { .exit = count_event, .ctx = &c };
+    int result;
+
+    p->visitor  = &v;
+    p->diag_out = stderr;
+    result = parser_parse_fd(p, STDIN_FILENO);
+    p->visitor  = NULL;
+
+    for (int k = 0; k < EVENT_KINDS; k++)
+        printf("%-12s %ld\n", event_name(k), c.kinds[k]);
+    if (exprs) {
+        printf("%-12s %zu\n", "exprs", store.seen);
+        printf("%-12s %u\n", "distinct", store.count);
+        printf("%-12s %.2f\n", "dedup", exprs_dedup(&store));
+        exprs_free(&store);
+    }
+    if (p->stream_error)
+        return 2;       /* reported with the diagnostics */
+    if (result == 0)
+        printf("Syntax valid.\n");
+    return result;
+}
+
+int main(int argc, char **argv) {
+    struct parse_stats stats = { 0 };
+    struct strbuf src = { 0 };
+    struct report report;
+    struct parser *p = parser_new();
+    const char *watch = NULL;
+    int use_stats = 0, uring = 1, jobs = 1, format = FORMAT_TEXT;
+    int dialect = DIALECT_PE2, rd = 0, check_bounds = 0, count = 0;
+    int exprs = 0;
+    int i;
+
+    /* --lsp takes no option but the dialect, which comes first */
+    if (argc >= 2 && strcmp(argv[argc - 1], "--lsp") == 0) {
+        parser_free(p);
+        if (argc > 3 || (argc == 3 &&
+                         (strncmp(argv[1], "--dialect=", 10) != 0 ||
+                          (dialect = parser_dialect(argv[1] + 10)) < 0))) {
+            usage(argv[0]);
+            return 2;
+        }
+        return lsp_main(dialect);
+    }
+
+    for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+        char *end;
+        if (strcmp(argv[i], "--stats") == 0) {
+            use_stats = 1;
+        } else if (strcmp(argv[i], "--no-uring") == 0) {
+            uring = 0;
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc &&
+                   (jobs = strtol(argv[i + 1], &end, 10)) >= 1 &&
+                   *end == '\0') {
+            i++;
+        } else if (strncmp(argv[i], "--format=", 9) == 0 &&
+                   (format = format_parse(argv[i] + 9)) >= 0) {
+            /* text, jsonl or sarif */
+        } else if (strncmp(argv[i], "--dialect=", 10) == 0 &&
+                   (dialect = parser_dialect(argv[i] + 10)) >= 0) {
+            /* pe2 or a1 */
+        } else if (strcmp(argv[i], "--parser=rd") == 0) {
+            rd = 1;
+        } else if (strcmp(argv[i], "--parser=lalr") == 0) {
+            rd = 0;
+        } else if (strcmp(argv[i], "--check-bounds") == 0) {
+            check_bounds = 1;
+        } else if (strcmp(argv[i], "--count") == 0) {
+            count = 1;
+        } else if (strcmp(argv[i], "--exprs") == 0) {
+            exprs = 1;
+        } else if (strcmp(argv[i], "--watch") == 0 && i + 1 < argc) {
+            watch = argv[++i];
+        } else if (strncmp(argv[i], "--max-depth=", 12) == 0 &&
+                   argv[i][12] != '\0' &&
+                   (p->stacks.max_depth =
+                        strtol(argv[i] + 12, &end, 10)) >= 0 &&
+                   *end == '\0') {
+            /* 0 = unlimited */
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    /* rd.c and the array table are a1's */
+    if ((rd || check_bounds) && dialect != DIALECT_A1) {
+        usage(argv[0]);
+        return 2;
+    }
+    /* one stream, reported in text, by the parser that fires events */
+    if (count && (i < argc || format != FORMAT_TEXT || rd || watch)) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (exprs && !count) {
+        usage(argv[0]);
+        return 2;
+    }
+    parser_set_dialect(p, dialect);
+    p->rd = rd;
+    p->check_bounds = check_bounds;
+    p->lex_threads = i < argc ? 1 : jobs;     /* files: see check.c */
+    if (i == argc && sysconf(_SC_NPROCESSORS_ONLN) > 1)
+        p->lex_pipe = TOKENS_PIPE_MIN;
+
+    if (watch) {
+        if (use_stats || format != FORMAT_TEXT || i < argc) {
+            usage(argv[0]);
+            return 2;
+        }
+        int status = watch_main(p, watch);
+        parser_free(p);
+        return status;
+    }
+
+    if (use_stats) {
+        p->stats = &stats;
+        parser_stats_begin(p, &stats);
+    }
+
+    int result;
+    report_begin(&report, format);
+    if (i < argc) {
+        result = check_files(p, argv + i, argc - i, jobs, uring, &report);
+    } else if (count) {
+        result = count_stream(p, exprs);
+    } else {
+        if (strbuf_read_fd(&src, STDIN_FILENO) < 0) {
+            perror("stdin");
+            return 2;
+        }
+        /* flex scans the buffer in place: it needs two NULs at the end */
+        strbuf_reserve(&src, 2);
+        src.data[src.len] = src.data[src.len + 1] = '\0';
+
+        if (format == FORMAT_TEXT) {
+            p->diag_out = stderr;
+            result = parser_parse_buffer(p, src.data, src.len);
+            if (result == 0) {
+                printf("Syntax valid.\n");
+            }
+            /* the diagnostics have already been printed on failure */
+        } else {
+            struct diag_buf diags = { 0 };
+            struct verdict v = { 0 };
+
+            result = parser_parse_buffer(p, src.data, src.len);
+            if (result != 0) {
+                v.status = 1;
+                v.diags  = diag_buf_add(&diags, 0, p);
+                v.ndiags = p->errors;
+            }
+            report_verdict(&report, REPORT_STDIN, &v);
+            diag_buf_free(&diags);
+        }
+    }
+    report_end(&report);
+
+    if (use_stats) {
+        stats_end(&stats);
+        stats_report(&stats, stderr);
+    }
+    parser_free(p);
+    strbuf_free(&src);
+    return result;
+}
@@ -0,0 +1,178 @@
+/*
+ * number.c - Numeric literal conversion (see number.h)
+ *
+ * Integers: at most 19 significant digits fit in a uint64_t without
+ * wrapping, so those are accumulated eight at a time with the SWAR
+ * multiply-and-shift below, and the result is checked against
+ * INT64_MAX once; a 20th significant digit is an overflow already.
+ *
+ * Floats have no exponent in this language, so the literal is
+ * w / 10^k: w its (up to 19) significant digits, k the fraction digits
+ * after trailing zeros are dropped.  Like Eisel-Lemire this works on
+ * the 64-bit w and a power of five rather than on the text, but
+ * without a table of truncated 128-bit powers and its ambiguous
+ * cases: 5^k is exact for k <= 27, and the 128-bit quotient w·2^64 / 5^k
+ * and its remainder give the 53 bits, the rounding bit and the sticky
+ * bit exactly.  Clinger's one-division path comes first, for w <= 2^53
+ * and k <= 22.  Anything else (more digits, more than 27 decimals)
+ * goes to strtod().
+ */
+
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "number.h"
+
+/* 10^0 .. 10^22: exactly representable as doubles */
+static const double exact_pow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+/* 5^0 .. 5^27: all below 2^63 */
+static const uint64_t pow5[] = {
+    1ULL,                   5ULL,                   25ULL,
+    125ULL,                 625ULL,                 3125ULL,
+    15625ULL,               78125ULL,               390625ULL,
+    1953125ULL,             9765625ULL,             48828125ULL,
+    244140625ULL,           1220703125ULL,          6103515625ULL,
+    30517578125ULL,         152587890625ULL,        762939453125ULL,
+    3814697265625ULL,       19073486328125ULL,      95367431640625ULL,
+    476837158203125ULL,     2384185791015625ULL,    11920928955078125ULL,
+    59604644775390625ULL,   298023223876953125ULL,  1490116119384765625ULL,
+    7450580596923828125ULL,
+};
+
+#define MAX_DIGITS 19   /* significant digits that fit in a uint64_t */
+#define MAX_POW5   27
+
+/* ================================================================
+   Integers
+   ================================================================ */
+
+/* The value of the eight digits at s: the bytes are subtracted to
+   0..9 in parallel, then adjacent pairs, quads and halves combined
+   with one multiply each (the digit order is the load's little-endian
+   byte order) */
+static uint32_t eight_digits(const char *s) {
+    uint64_t v;
+
+    memcpy(&v, s, 8);
+    v -= 0x3030303030303030ULL;
+    v = v * 10 + (v >> 8);
+    v = ((v & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32)) +
+         ((v >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32))) >> 32;
+    return (uint32_t) v;
+}
+
+/* The value of n <= MAX_DIGITS digits at s */
+static uint64_t digits(const char *s, size_t n) {
+    uint64_t v = 0;
+    size_t i = 0;
+
+    for (; n - i >= 8; i += 8)
+        v = v * 100000000 + eight_digits(s + i);
+    for (; i < n; i++)
+        v = v * 10 + (uint64_t) (s[i] - '0');
+    return v;
+}
+
+struct number number_int(const char *s, size_t len) {
+    struct number n = { .kind = NUMBER_INT };
+    uint64_t v;
+
+    while (len > 1 && *s == '0') {
+        s++;
+        len--;
+    }
+    if (len > MAX_DIGITS || (v = digits(s, len)) > INT64_MAX)
+        n.overflow = 1;
+    else
+        n.i = (int64_t) v;
+    return n;
+}
+
+/* ================================================================
+   Floats
+   ================================================================ */
+
+/* w / 10^k, correctly rounded, for w > 0 and k <= MAX_POW5 */
+static double divide(uint64_t w, int k) {
+    int lz = __builtin_clzll(w);
+    unsigned __int128 num = (unsigned __int128) (w << lz) << 64;
+    unsigned __int128 q = num / pow5[k];
+    int sticky = num % pow5[k] != 0;
+
+    /* num >= 2^127 and 5^k < 2^63, so q has 65 to 128 bits: keep the
+       top 54, the last of them the rounding bit */
+    int shift = 64 - __builtin_clzll((uint64_t) (q >> 64)) + 64 - 54;
+    uint64_t m = (uint64_t) (q >> shift);
+    sticky |= (q & (((unsigned __int128) 1 << shift) - 1)) != 0;
+
+    /* round half to even */
+    int round = m & 1;
+    m >>= 1;
+    if (round && (sticky || (m & 1)))
+        m++;
+
+    /* w / 10^k = q · 2^(-64-lz-k), and q ≈ m · 2^(shift+1) */
+    int e = shift + 1 - 64 - lz - k;
+    if (m >> 53) {          /* rounding carried into a 54th bit */
+        m >>= 1;
+        e++;
+    }
+    /* 10^-27 is nowhere near the subnormals: m is 53 bits, top one
+       implicit */
+    uint64_t bits = (uint64_t) (e + 52 + 1023) << 52 |
+                    (m & ((1ULL << 52) - 1));
+    double d;
+    memcpy(&d, &bits, sizeof d);
+    return d;
+}
+
+/* strtod() on a copy: s[len] may be a digit or 'e' of the next token */
+static double slow(const char *s, size_t len) {
+    char buf[64], *t = len < sizeof buf ? buf : malloc(len + 1);
+    double d;
+
+    if (!t)
+        return strtod(s, NULL);     /* flex's yytext: NUL-terminated */
+    memcpy(t, s, len);
+    t[len] = '\0';
+    d = strtod(t, NULL);
+    if (t != buf)
+        free(t);
+    return d;
+}
+
+struct number number_float(const char *s, size_t len) {
+    struct number n = { .kind = NUMBER_FLOAT };
+    const char *dot = memchr(s, '.', len);
+    size_t end = len, i, sig = 0;
+    uint64_t w = 0;
+    int k;
+
+    while (s + end - 1 > dot && s[end - 1] == '0')
+        end--;
+    k = (int) (end - (size_t) (dot - s) - 1);
+
+    for (i = 0; i < end; i++) {
+        if (s[i] == '.' || (w == 0 && s[i] == '0'))
+            continue;
+        if (++sig > MAX_DIGITS)
+            break;
+        w = w * 10 + (uint64_t) (s[i] - '0');
+    }
+
+    if (sig > MAX_DIGITS || k > MAX_POW5)
+        n.f = slow(s, len);
+    else if (w == 0 || k == 0)
+        n.f = (double) w;
+    else if (w <= 1ULL << 53 && k <= 22)
+        n.f = (double) w / exact_pow10[k];
+    else
+        n.f = divide(w, k);
+    n.overflow = n.f > DBL_MAX;
+    return n;
+}
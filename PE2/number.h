@@ -0,0 +1,36 @@
+/*
+ * number.h - Values of numeric literals, converted by the scanner
+ *
+ * {INT_NUM} and {FLOAT_NUM} reach the parser as a struct number rather
+ * than text: no strdup per literal, and nothing downstream parses the
+ * digits again.  Integers are read eight digits at a time (SWAR);
+ * floats take an exact fast path for up to 19 significant digits and
+ * fall back to strtod() beyond it, and both round correctly.
+ */
+
+#ifndef NUMBER_H
+#define NUMBER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum number_kind { NUMBER_INT, NUMBER_FLOAT };
+
+struct number {
+    enum number_kind kind;
+    int              overflow;  /* out of range: the value is not usable */
+    union {
+        int64_t      i;         /* NUMBER_INT                           */
+        double       f;         /* NUMBER_FLOAT                         */
+    };
+};
+
+/* s[0 .. len) are decimal digits: their value, or overflow if it does
+   not fit in an int64_t */
+struct number number_int(const char *s, size_t len);
+
+/* s[0 .. len) are digits, '.', digits: the nearest double, or overflow
+   if it is infinite */
+struct number number_float(const char *s, size_t len);
+
+#endif /* NUMBER_H */
@@ -0,0 +1,370 @@
+/*
+ * parser.c - Parser instances and their diagnostics (see parser.h)
+ *
+ * Everything here is the same for every dialect: the generated parsers
+ * (parser_pe2.tab.c, parser_a1.tab.c, see grammar.h) only scan, parse
+ * and name their symbols, and report what they find through
+ * parser_diag() and parser_syntax_error().
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "grammar.h"
+#include "parser.h"
+#include "strbuf.h"
+#include "tokens.h"
+
+/* Indexed by enum dialect */
+static const struct grammar *const grammars[] = {
+    [DIALECT_PE2] = &pe2_grammar,
+    [DIALECT_A1]  = &a1_grammar,
+};
+
+#define NDIALECTS (int) (sizeof grammars / sizeof grammars[0])
+
+/* ================================================================
+   Diagnostics
+   ================================================================ */
+
+/* Line and column of offset in the buffer (or stream) being parsed */
+static void position(struct parser *p, size_t offset,
+                     int *line, int *column) {
+    if (p->stream_fd >= 0) {
+        p->grammar->stream_position(p->scanner, offset, line, column);
+    } else {
+        /* flex's NUL after the token may stand for a newline */
+        p->grammar->hold(p->scanner, 0);
+        lines_find(&p->lines, offset, line, column);
+        p->grammar->hold(p->scanner, 1);
+    }
+    *line += p->first_line;
+}
+
+/* The token being scanned, or the last one taken from p->ahead */
+static size_t token_start(struct parser *p) {
+    return p->ahead ? tokens_start(p->ahead)
+                    : p->grammar->token_start(p->scanner);
+}
+
+const char *parser_token_text(struct parser *p) {
+    return p->ahead ? tokens_text(p->ahead)
+                    : p->grammar->token_text(p->scanner);
+}
+
+size_t parser_offset(struct parser *p) {
+    return token_start(p);
+}
+
+int parser_line_of(struct parser *p, size_t offset) {
+    int line, column;
+
+    position(p, offset, &line, &column);
+    return line;
+}
+
+int parser_line(struct parser *p) {
+    return parser_line_of(p, token_start(p));
+}
+
+/* Record one more diagnostic (collected, not printed) */
+static struct parse_diag *record(struct parser *p) {
+    if (p->errors == p->diags_cap) {
+        p->diags_cap = p->diags_cap ? 2 * p->diags_cap : 16;
+        p->diags = xrealloc(p->diags, p->diags_cap * sizeof *p->diags);
+    }
+    return &p->diags[p->errors++];
+}
+
+/* Report a diagnostic at line and column with the scanner on tok, of
+   token kind (-1 if none) where expected[] would have been accepted */
+static void vdiag_at(struct parser *p, int line, int column,
+                     const char *tok, int kind, const int *expected,
+                     int nexpected, const char *fmt, va_list ap) {
+    if (p->errors == 0)
+        p->err_line = line;
+    if (p->diag_out) {
+        p->errors++;
+        vfprintf(p->diag_out, fmt, ap);
+        fputc('\n', p->diag_out);
+        return;
+    }
+    struct parse_diag *d = record(p);
+    d->line      = line;
+    d->column    = column;
+    d->kind      = kind;
+    d->msg       = p->diag.len;
+    strbuf_vaddf(&p->diag, fmt, ap);
+    d->msg_len   = p->diag.len - d->msg;
+    strbuf_add(&p->diag, "\n", 1);
+    d->tok       = p->tokens.len;
+    d->tok_len   = strlen(tok);
+    strbuf_add(&p->tokens, tok, d->tok_len);
+    d->expected  = p->expected.len / sizeof(int);
+    d->nexpected = nexpected;
+    if (nexpected)
+        strbuf_add(&p->expected, expected, nexpected * sizeof(int));
+}
+
+static void diag_at(struct parser *p, int line, int column,
+                    const char *tok, int kind, const int *expected,
+                    int nexpected, const char *fmt, ...)
+    __attribute__((format(printf, 8, 9)));
+
+static void diag_at(struct parser *p, int line, int column,
+                    const char *tok, int kind, const int *expected,
+                    int nexpected, const char *fmt, ...) {
+    va_list ap;
+
+    va_start(ap, fmt);
+    vdiag_at(p, line, column, tok, kind, expected, nexpected, fmt, ap);
+    va_end(ap);
+}
+
+void parser_diag(struct parser *p, const char *fmt, ...) {
+    int line, column;
+    va_list ap;
+
+    position(p, token_start(p), &line, &column);
+    va_start(ap, fmt);
+    vdiag_at(p, line, column, parser_token_text(p), -1, NULL, 0, fmt, ap);
+    va_end(ap);
+}
+
+void parser_syntax_error(struct parser *p, size_t offset, int kind,
+                         const int *expected, int nexpected) {
+    const char *tok = parser_token_text(p);
+    int line, column;
+
+    position(p, offset, &line, &column);
+    diag_at(p, line, column, tok, kind, expected, nexpected,
+            "Syntax error at line %d, token : '%s'", line, tok);
+}
+
+/* ================================================================
+   Parser instances
+   ================================================================ */
+struct parser *parser_new(void) {
+    struct parser *p = xcalloc(1, sizeof *p);
+    p->stacks.max_depth = DEFAULT_MAX_DEPTH;
+    p->stream_fd = -1;
+    parser_set_dialect(p, DIALECT_PE2);
+    return p;
+}
+
+void parser_free(struct parser *p) {
+    if (!p)
+        return;
+    if (p->scanner)
+        p->grammar->scanner_free(p->scanner);
+    stacks_free(&p->stacks);
+    strbuf_free(&p->input);
+    strbuf_free(&p->diag);
+    strbuf_free(&p->tokens);
+    strbuf_free(&p->expected);
+    free(p->diags);
+    lines_free(&p->lines);
+    arrays_reset(&p->arrays);
+    if (p->lexed)
+        tokens_free(p->lexed);
+    if (p->batch)
+        tokens_free(p->batch);
+    free(p->lexed);
+    free(p->batch);
+    free(p);
+}
+
+int parser_dialect(const char *name) {
+    for (int d = 0; d < NDIALECTS; d++)
+        if (strcmp(grammars[d]->name, name) == 0)
+            return d;
+    return -1;
+}
+
+/* The scanner is made by the first parse: a process that exits
+   before (usage error, empty input, --lsp) never pays for it, and one
+   that switches dialect pays once */
+void parser_set_dialect(struct parser *p, enum dialect d) {
+    if (p->grammar == grammars[d])
+        return;
+    if (p->scanner)
+        p->grammar->scanner_free(p->scanner);
+    p->scanner = NULL;
+    p->grammar = grammars[d];
+    p->dialect = d;
+}
+
+int parser_parse_buffer(struct parser *p, char *buf, size_t len) {
+    return parser_parse_at(p, buf, len, 1);
+}
+
+/* State every parse starts from */
+static void begin(struct parser *p, int line) {
+    p->errors = 0;
+    strbuf_reset(&p->diag);
+    strbuf_reset(&p->tokens);
+    strbuf_reset(&p->expected);
+    p->first_line = line;
+    p->scan_base = 0;
+    p->tok_end = 0;
+    p->at_eof = 0;
+    if (!p->scanner && p->grammar->scanner_new(p, &p->scanner) != 0)
+        out_of_memory();
+}
+
+/* Scan buf on p->lex_threads threads, then parse its tokens (not with
+   lazy_blocks: skipping a body is the scanner's job) */
+static int parse_ahead(struct parser *p, char *buf, size_t len) {
+    uint64_t start = p->stats ? stats_cycles() : 0;
+    int result;
+
+    if (!p->lexed)
+        p->lexed = xcalloc(1, sizeof *p->lexed);
+    tokens_scan(p->grammar, buf, len, p->lex_threads, p->lexed);
+    if (p->stats)
+        p->stats->lex_cycles += stats_cycles() - start;
+
+    p->ahead = p->lexed;
+    result = p->grammar->parse_ahead(p);
+    p->ahead = NULL;
+    return result;
+}
+
+/* Parse buf, with the scanner filling p->batch as the parser empties
+   it (not with lazy_blocks, as above) */
+static int parse_batched(struct parser *p, char *buf, size_t len) {
+    int result;
+
+    if (!p->batch)
+        p->batch = xcalloc(1, sizeof *p->batch);
+    tokens_ring(p->batch, (size_t) p->token_batch, p->grammar->scan_batch,
+                p->scanner, buf);
+
+    p->ahead = p->batch;
+    result = p->grammar->parse(p, buf, len);
+    p->ahead = NULL;
+    return result;
+}
+
+/* Parse buf while a thread of its own scans it into p->batch (or as if
+   lex_pipe were not set, if the thread cannot start) */
+static int parse_piped(struct parser *p, char *buf, size_t len) {
+    size_t batch = p->token_batch > 0 ? (size_t) p->token_batch
+                                      : TOKENS_BATCH;
+    struct token_pipe *pipe;
+    int result;
+
+    if (!p->batch)
+        p->batch = xcalloc(1, sizeof *p->batch);
+    pipe = tokens_pipe(p->grammar, buf, len, batch, p->batch);
+    if (!pipe)
+        return p->token_batch > 0 ? parse_batched(p, buf, len)
+                                  : p->grammar->parse(p, buf, len);
+
+    p->ahead = p->batch;
+    result = p->grammar->parse_ahead(p);
+    p->ahead = NULL;
+    if (tokens_pipe_end(pipe) != 0)
+        result = -1;
+    return result;
+}
+
+/* Worth a second thread (not with lazy_blocks, as above, nor --stats,
+   which times the scanner on this one) */
+static int piped(const struct parser *p, size_t len) {
+    return p->lex_pipe && len >= p->lex_pipe && !p->lazy_blocks &&
+           !p->stats;
+}
+
+int parser_parse_at(struct parser *p, char *buf, size_t len, int line) {
+    int result;
+
+    begin(p, line);
+    lines_reset(&p->lines, buf, len);
+    arrays_reset(&p->arrays);
+    if (p->stats)
+        p->stats->bytes += len;
+
+    if (p->lex_threads > 1 && !p->lazy_blocks &&
+        len >= 2 * TOKENS_CHUNK_MIN)
+        result = parse_ahead(p, buf, len);
+    else if (piped(p, len))
+        result = parse_piped(p, buf, len);
+    else if (p->token_batch > 0 && !p->lazy_blocks)
+        result = parse_batched(p, buf, len);
+    else
+        result = p->grammar->parse(p, buf, len);
+    if (result < 0) {
+        /* a diagnostic from outside the scan: there is no token */
+        diag_at(p, line, 0, "", -1, NULL, 0, "Out of memory");
+        return 1;
+    }
+    /* a dialect may report errors that do not stop the parse */
+    return result || p->errors ? 1 : 0;
+}
+
+/* The arrays declared before the body stay declared */
+int parser_parse_body(struct parser *p, char *buf, size_t len,
+                      struct span body) {
+    char end[2] = { buf[body.end], buf[body.end + 1] };
+    int result;
+
+    begin(p, 1);
+    lines_reset(&p->lines, buf, len);
+    p->scan_base = body.begin;
+    if (p->stats)
+        p->stats->bytes += body.end - body.begin;
+
+    /* flex's two NULs, over the '}' and the byte after it */
+    buf[body.end] = buf[body.end + 1] = '\0';
+    result = p->grammar->parse(p, buf + body.begin, body.end - body.begin);
+    buf[body.end]     = end[0];
+    buf[body.end + 1] = end[1];
+    if (result < 0) {
+        diag_at(p, 1, 0, "", -1, NULL, 0, "Out of memory");
+        return 1;
+    }
+    return result || p->errors ? 1 : 0;
+}
+
+int parser_parse_fd(struct parser *p, int fd) {
+    int result;
+
+    begin(p, 1);
+    arrays_reset(&p->arrays);
+    p->stream_fd = fd;
+    p->stream_read = p->stream_lines = 0;
+    p->stream_error = 0;
+
+    result = p->grammar->parse_stream(p);
+    if (p->stream_error)
+        diag_at(p, (int) p->stream_lines + 1, 0, "", -1, NULL, 0,
+                "Read error: %s", strerror(p->stream_error));
+    p->stream_fd = -1;
+    if (p->stats)
+        p->stats->bytes += p->stream_read;
+    return result || p->errors ? 1 : 0;
+}
+
+int parser_parse(struct parser *p, const char *src, size_t len) {
+    strbuf_reset(&p->input);
+    strbuf_reserve(&p->input, len + 2);
+    memcpy(p->input.data, src, len);
+    p->input.data[len] = p->input.data[len + 1] = '\0';
+    p->input.len = len;
+    return parser_parse_buffer(p, p->input.data, len);
+}
+
+/* ================================================================
+   --stats support: counter sizes and symbol names
+   ================================================================ */
+void parser_stats_begin(const struct parser *p, struct parse_stats *stats) {
+    stats_begin(stats, p->grammar->ntokens, p->grammar->nrules,
+                p->grammar->token_name, p->grammar->rule_name);
+}
+
+const char *parser_token_name(const struct parser *p, int kind) {
+    return p->grammar->token_name(kind);
+}
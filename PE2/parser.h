@@ -0,0 +1,194 @@
+/*
+ * parser.h - Reentrant parser instances
+ *
+ * A struct parser bundles one flex scanner, one set of parser stacks
+ * and the buffers a parse needs.  Instances share nothing, so each
+ * thread can own one, and everything they allocate is kept between
+ * parses: a long-running process (c_parserd) pays for scanner set-up
+ * and stack growth once, not once per input.
+ *
+ * An instance parses one dialect of the language at a time: PE2, or
+ * the Assignment 1 extensions (for, switch, arrays, ++ and --, ...).
+ * Each dialect has its own generated tables and scanner (grammar.h),
+ * and parser_set_dialect() switches between them.
+ */
+
+#ifndef PARSER_H
+#define PARSER_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "arrays.h"
+#include "lines.h"
+#include "stacks.h"
+#include "stats.h"
+#include "strbuf.h"
+
+/* The dialects, as named by --dialect= */
+enum dialect {
+    DIALECT_PE2,        /* "pe2": the language of PE2              */
+    DIALECT_A1,         /* "a1":  with the Assignment 1 extensions */
+};
+
+/* Location of a token or a rule (Bison's YYLTYPE): byte offsets from
+   the start of the buffer being parsed (or stream, see
+   parser_parse_fd()), [begin, end) */
+struct span {
+    size_t  begin;
+    size_t  end;
+};
+
+/* Where one collected diagnostic is (diag_out NULL) */
+struct parse_diag {
+    int     line;       /* line it was reported at             */
+    int     column;     /* of the token, from 1 (0: unknown)   */
+    int     kind;       /* its symbol kind, or -1              */
+    size_t  msg;        /* its text: diag.data + msg, without  */
+    size_t  msg_len;    /*   the newline                       */
+    size_t  tok;        /* the token being scanned:            */
+    size_t  tok_len;    /*   tokens.data + tok                 */
+    size_t  expected;   /* kinds the parser would have taken:  */
+    int     nexpected;  /*   (int *) expected.data + expected  */
+};
+
+struct grammar;
+struct token_buf;
+struct visitor;
+
+struct parser {
+    /* ── Options, set before parsing ── */
+    const struct grammar *grammar; /* the dialect's tables and scanner
+                                      (see parser_set_dialect())       */
+    enum dialect        dialect;
+    int                 rd;        /* a1: parse with rd.c, not Bison   */
+    int                 check_bounds;  /* a1: --check-bounds           */
+    int                 lazy_blocks;   /* skip block bodies, see
+                                          parser_parse_body()          */
+    int                 lex_threads;   /* scan large buffers on this
+                                          many threads first (tokens.h)*/
+    int                 token_batch;   /* scan this many tokens at a
+                                          time, ahead of the parser
+                                          (tokens.h), or 0: one by one */
+    size_t              lex_pipe;      /* scan buffers this large or
+                                          larger on a thread of their
+                                          own, while they are parsed
+                                          (tokens.h), or 0: never      */
+    struct parse_stats *stats;     /* counters for --stats, or NULL    */
+    FILE               *diag_out;  /* print diagnostics here, or NULL
+                                      to collect them in diag          */
+    const struct visitor *visitor; /* parse events go here, or NULL
+                                      (see events.h)                   */
+
+    /* Called after each top-level statement with the offset (from the
+       start of the buffer) just past it; returning non-zero ends the
+       parse early as a success.  NULL to skip the bookkeeping. */
+    int               (*on_top)(struct parser *p, size_t end);
+    void               *top_ctx;   /* for on_top's use                 */
+
+    /* ── Per-instance state ── */
+    void               *scanner;   /* flex yyscan_t, made by 1st parse */
+    struct stack_arena  stacks;    /* stacks.max_depth is --max-depth  */
+    struct strbuf       input;     /* padded copy of the current input */
+    struct strbuf       diag;      /* collected diagnostics            */
+    struct strbuf       tokens;    /* ... the token text of each       */
+    struct strbuf       expected;  /* ... the tokens it expected (int) */
+    struct parse_diag  *diags;     /* ... and where each one is        */
+    int                 diags_cap;
+    int                 errors;    /* diagnostics in the last parse    */
+    int                 err_line;  /* line of the first one            */
+    struct line_table   lines;     /* newlines, found when one is asked
+                                      for (see lines.h)                */
+    int                 first_line;/* line the buffer starts on        */
+    struct array_table  arrays;    /* a1: the arrays declared so far   */
+    struct token_buf   *lexed;     /* tokens scanned ahead (tokens.h)  */
+    struct token_buf   *batch;     /* ... or a batch at a time         */
+    struct token_buf   *ahead;     /* ... yylex() takes them if set    */
+
+    /* ── Streamed input (parser_parse_fd()) ── */
+    int                 stream_fd; /* read from here, or -1            */
+    const char         *stream_src;/* ... or copied from here (tokens.c) */
+    size_t              stream_len;
+    size_t              stream_read;   /* bytes read so far            */
+    size_t              stream_lines;  /* newlines among them          */
+    int                 stream_error;  /* errno of a failed read, or 0 */
+    size_t              scan_base; /* offset of the scanner's buffer   */
+
+    /* ── Scan position, tracked only while on_top is set ── */
+    size_t              tok_end;   /* offset just past the last token  */
+    int                 at_eof;    /* end of input reached            */
+};
+
+/* Create / destroy an instance of the PE2 dialect (exits on
+   out-of-memory) */
+struct parser *parser_new(void);
+void parser_free(struct parser *p);
+
+/* The dialect called name, or -1 if there is none */
+int parser_dialect(const char *name);
+
+/* Parse dialect d from now on (exits on out-of-memory) */
+void parser_set_dialect(struct parser *p, enum dialect d);
+
+/*
+ * Parse len bytes of source.  The text is copied into the instance's
+ * input buffer, which flex scans in place.  Returns 0 if the input is
+ * valid; diagnostics go to diag_out or are appended to diag (which is
+ * cleared first).
+ */
+int parser_parse(struct parser *p, const char *src, size_t len);
+
+/*
+ * Parse buf[0..len) in place, without copying.  flex needs two
+ * writable NUL bytes after the text: buf[len] and buf[len + 1].
+ * With lex_threads set, a buffer of two chunks (TOKENS_CHUNK_MIN) or
+ * more is scanned on that many threads before it is parsed.  Otherwise,
+ * a buffer of lex_pipe bytes or more (TOKENS_PIPE_MIN is where a CPU to
+ * spare pays off) is scanned on a second thread while this one parses
+ * it; with token_batch set, it is scanned that many tokens at a time.
+ */
+int parser_parse_buffer(struct parser *p, char *buf, size_t len);
+
+/* parser_parse_buffer() for text that starts on the given line */
+int parser_parse_at(struct parser *p, char *buf, size_t len, int line);
+
+/*
+ * With lazy_blocks set, parsing buf skips the statements inside each
+ * block, checking only that its braces match, and reports the range
+ * between them in the block's events (events.h).  This parses one such
+ * body, buf[body.begin .. body.end), as a list of statements located in
+ * buf as a whole (its blocks are skipped in turn while lazy_blocks is
+ * set); the bytes at body.end are put back as they were.
+ */
+int parser_parse_body(struct parser *p, char *buf, size_t len,
+                      struct span body);
+
+/*
+ * Parse everything that can be read from fd, a block at a time: the
+ * scanner keeps only the block being scanned and the token it is in,
+ * so memory does not grow with the input.  Locations are offsets from
+ * the start of the stream.  Meant for a visitor (events.h); a read
+ * error is reported as a diagnostic.
+ */
+int parser_parse_fd(struct parser *p, int fd);
+
+/* Report a diagnostic at the token being scanned (printf-style) */
+void parser_diag(struct parser *p, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+/* Line of the token being scanned, for diagnostics' text */
+int parser_line(struct parser *p);
+
+/* Offset of the token being scanned: cheaper to keep than its line,
+   which parser_line_of() finds when a diagnostic needs it (in the
+   buffer being parsed, or what of a stream flex still holds) */
+size_t parser_offset(struct parser *p);
+int parser_line_of(struct parser *p, size_t offset);
+
+/* Start counting p's dialect into stats (p->stats is not set) */
+void parser_stats_begin(const struct parser *p, struct parse_stats *stats);
+
+/* Name of a symbol kind of p's dialect, as in struct parse_diag */
+const char *parser_token_name(const struct parser *p, int kind);
+
+#endif /* PARSER_H */
@@ -8,42 +8,220 @@
  *   - do-while statements
  *   - Nested blocks  { ... }
  *   - Arithmetic and relational expressions
+ *
+ * This file is the grammar of every dialect (see parser.h); dialect.awk
+ * cuts one out per dialect before Bison sees it, so each gets tables of
+ * its own size (see README.md for the directives).  The "a1" dialect
+ * (Assignment 1) adds:
+ *   - for loops  : for(i=0, j=0; i<p && j<q; i++, j++)
+ *   - while loops: while (expr) stmt
+ *   - switch     : switch(expr) { case NUM: ... default: ... }
+ *   - Arrays     : int a[15]; int a[10][10]; int a[4][4], b[5];
+ *   - ++/-- and +=/-= operators
+ *   - && and || logical operators
+ *
+ * In a1, array declarations are recorded in the parser's array table
+ * (arrays.h) with their extents and row-major strides.  Integer
+ * expressions are folded as they reduce, so with --check-bounds a
+ * constant subscript that is out of range for its dimension is
+ * rejected.  With --parser=rd the hand-written parser in rd.c runs
+ * instead of yyparse(), sharing the scanner and the actions below.
+ *
+ * With --stats the parser counts tokens by kind, reductions per rule
+ * and the deepest stack it reached, and times the lexer against the
+ * parser (see stats.h).
+ *
+ * The parser stacks grow into a reusable arena instead of stopping at
+ * Bison's YYMAXDEPTH; the limit is set with --max-depth (see stacks.h).
+ *
+ * The parser is pure and takes its struct parser (parser.h) as a
+ * parameter, so any number of instances can parse concurrently.
+ *
+ * Each top-level statement is reported through p->on_top with the byte
+ * offset where it ends; document.c uses those boundaries to reparse
+ * only the statements an edit touches.  With on_top set, the parse
+ * stops at the first statement that reported anything.
+ *
+ * With a visitor (events.h) the actions also report each statement,
+ * declarator, operator, name and literal as it is recognized.  A
+ * keyword-led statement is entered from a rule of its own that reduces
+ * its first token alone (if_head: IF, ...), before its parts are
+ * parsed.  With lazy_blocks, block_head has the scanner skip straight
+ * to the block's '}' (braces.h), and the body is reported as a range
+ * to parse later with parser_parse_body().
+ *
+ * yylex() takes its tokens from the scanner, or from p->ahead when they
+ * are scanned in batches or a large buffer was scanned on several
+ * threads first (tokens.h); either way it is what reports the scanner's
+ * errors.
  */
 
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-/* Supplied by the lexer */
-extern int  yylineno;
-extern int  yylex(void);
-extern char *yytext;
+#include "events.h"
+#include "grammar.h"
+#include "parser.h"
+#include "tokens.h"
+%if a1
+#include "rd.h"
 
-/* Called by Bison on parse error */
-void yyerror(const char *msg) {
-    fprintf(stderr,
-        "Syntax error at line %d, token : '%s'\n",
-        yylineno, yytext);
-}
+static const struct cexpr UNKNOWN = { 0, 0 };
+%endif
+
+/* Bison expands YYLLOC_DEFAULT once per reduction, inside yyparse(),
+   just before the rule's action: the rule number (yyn) and the state
+   stack (yyss..yyssp) are in scope there, which makes it the hook for
+   per-rule reduction counts and the maximum stack depth.  A rule's
+   location spans its first symbol to its last (an empty one sits where
+   the symbol before it ends). */
+#define YYLLOC_DEFAULT(Cur, Rhs, N)                                     \
+    do {                                                                \
+        if (p->stats)                                                   \
+            stats_reduce(p->stats, yyn - 1, (long) (yyssp - yyss) + 1); \
+        if (N) {                                                        \
+            (Cur).begin = YYRHSLOC(Rhs, 1).begin;                       \
+            (Cur).end   = YYRHSLOC(Rhs, N).end;                         \
+        } else {                                                        \
+            (Cur).begin = (Cur).end = YYRHSLOC(Rhs, 0).end;             \
+        }                                                               \
+    } while (0)
+
+/* Parser stacks move to p->stacks once they outgrow yyparse()'s own */
+static void grow_stacks(struct parser *p,
+                        void **ss, size_t ss_bytes, size_t ss_elem,
+                        void **vs, size_t vs_bytes, size_t vs_elem,
+                        void **ls, size_t ls_bytes, size_t ls_elem,
+                        long *depth);
+
+/* Defining yyoverflow replaces Bison's fixed-limit stack relocation
+   (and leaves its yyexhaustedlab label unused): quiet that warning
+   until the end of yyparse(), where the epilogue pops it */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-label"
+#define yyoverflow(Msg, Ss, SsBytes, Vs, VsBytes, Ls, LsBytes, Depth)  \
+    do {                                                                \
+        void *ss_ = *(Ss), *vs_ = *(Vs), *ls_ = *(Ls);                  \
+        long depth_ = *(Depth);                                         \
+        (void) (Msg);                                                   \
+        grow_stacks(p, &ss_, SsBytes, sizeof **(Ss),                    \
+                    &vs_, VsBytes, sizeof **(Vs),                       \
+                    &ls_, LsBytes, sizeof **(Ls), &depth_);             \
+        *(Ss) = ss_;                                                    \
+        *(Vs) = vs_;                                                    \
+        *(Ls) = ls_;                                                    \
+        *(Depth) = depth_;                                              \
+    } while (0)
 %}
 
+/* The instance types are part of the parser's interface */
+%code requires {
+#include "number.h"
+#include "parser.h"
+}
+
+/* Reentrant: all state lives on the stack or in the struct parser */
+%define api.pure full
+%param {struct parser *p}
+
+/* Every dialect's symbols have a prefix of their own (pe2_yyparse,
+   A1_YYSTYPE, ...), so they can all be linked into one program */
+%define api.prefix {@dialect@_yy}
+
+/* Locations are byte offsets (struct span), set by the scanner for
+   each token; lines and columns are worked out from them only when a
+   diagnostic needs one (see lines.h) */
+%locations
+%define api.location.type {struct span}
+
+/* Syntax errors go to yyreport_syntax_error(), which records the
+   lookahead's kind and the tokens the parser would have accepted.
+   This also keeps the symbol names (yysymbol_name) that the --stats
+   report uses. */
+%define parse.error custom
+
 /* ── Value type for semantic records ── */
 %union {
-    char *str;   /* identifier / number text */
+    char                  *str;    /* identifier text              */
+    struct number          num;    /* value of a numeric literal   */
+    int                    skip;   /* block_head: body skipped     */
+%if a1
+    struct cexpr           cval;   /* folded value of an expr      */
+    struct subscript_list *subs;   /* dim_list / index_list items  */
+%endif
 }
 
 /* ── Tokens from the lexer ── */
-%token <str> ID NUM
+%token <str> ID
+%token <num> NUM
+
+/* Identifier text is strdup'd by the lexer: free it wherever the parser
+   drops it, so long-running processes do not leak */
+%destructor { free($$); } <str>
 %token INT FLOAT CHAR DOUBLE
 %token IF ELSE DO WHILE
 %token EQ NEQ LE GE LT GT
 
+%type <skip> block_head
+%if a1
+%token FOR SWITCH CASE DEFAULT BREAK
+%token INC DEC ADDASSIGN SUBASSIGN
+%token AND OR
+
+%type <cval> expr
+%type <subs> dim_list index_list
+%destructor { subscripts_free($$); } <subs>
+%endif
+
+%code {
+int  yylex(YYSTYPE *lval, YYLTYPE *lloc, struct parser *p);
+void yyerror(YYLTYPE *loc, struct parser *p, const char *msg);
+
+/* Report a construct to the visitor, if there is one: EVENT(enter,
+   kind, span, ...), EVENT(exit, ...) or EVENT(seen, ...) for both at
+   once, any other fields of its struct event designated after the
+   span */
+#define EVENT(fire, k, ...)                                             \
+    do {                                                                \
+        if (p->visitor) {                                               \
+            struct event e_ = { .kind = (k), .span = __VA_ARGS__ };     \
+            event_##fire(p, &e_);                                       \
+        }                                                               \
+    } while (0)
+
+#define OPERATOR(o, n, loc) \
+    EVENT(seen, EVENT_OPERATOR, (loc), .op = (o), .operands = (n))
+
+/* ++/-- on a variable, as an operator with no operand expression */
+#define INCDEC(o, id, loc)                                              \
+    do {                                                                \
+        EVENT(seen, EVENT_OPERATOR, (loc), .name = (id), .op = (o));    \
+        free(id);                                                       \
+    } while (0)
+
+/* An assignment statement: report it, then drop the name */
+#define ASSIGN(o, id, loc)                                              \
+    do {                                                                \
+        EVENT(seen, EVENT_EXPR_STMT, (loc), .name = (id), .op = (o));   \
+        free(id);                                                       \
+    } while (0)
+}
+
 /* ── Operator precedence (low → high) ── */
+%if a1
+%left  OR
+%left  AND
+%endif
 %left  EQ NEQ
 %left  LT GT LE GE
 %left  '+' '-'
 %left  '*' '/' '%'
 %right UMINUS          /* unary minus pseudo-token */
+%if a1
+%right INC DEC
+%endif
 
 %%
 
@@ -51,7 +229,21 @@ void yyerror(const char *msg) {
    Top-level program: zero or more statements
    ================================================================ */
 program
-    : stmt_list          { /* entire input accepted */ }
+    : top_list           { /* entire input accepted */ }
+    ;
+
+/* ── The program's own statements, reported one by one ── */
+top_list
+    : /* empty */
+    | top_list stmt      {
+                             /* a diagnostic the parse went on after (a
+                                literal out of range) ends it here for
+                                on_top's caller, as a syntax error would */
+                             if (p->on_top && p->errors)
+                                 YYABORT;
+                             if (p->on_top && p->on_top(p, @2.end))
+                                 YYACCEPT;
+                         }
     ;
 
 /* ── A list of zero or more statements ── */
@@ -67,8 +259,16 @@ stmt
     : decl_stmt          /* variable declaration */
     | if_stmt            /* if / if-else          */
     | do_while_stmt      /* do-while              */
+%if a1
+    | while_stmt         /* while                 */
+    | for_stmt           /* for                   */
+    | switch_stmt        /* switch                */
+%endif
     | block              /* bare block  { ... }   */
     | expr_stmt          /* expression ; (assign) */
+%if a1
+    | BREAK ';'          { EVENT(seen, EVENT_BREAK, @$); }
+%endif
     ;
 
 /* ================================================================
@@ -77,9 +277,16 @@ stmt
        int x;
        float a, b, c;
        int p = 5, q;          (with optional initialiser)
+       int arr[10][10];       (a1)
    ================================================================ */
 decl_stmt
-    : type declarator_list ';'
+    : decl_head declarator_list ';'
+                         { EVENT(exit, EVENT_DECL, @$); }
+    ;
+
+/* The type says it is a declaration: enter it before its declarators */
+decl_head
+    : type               { EVENT(enter, EVENT_DECL, @1); }
     ;
 
 type
@@ -94,11 +301,44 @@ declarator_list
     | declarator_list ',' declarator
     ;
 
-/* A declarator is an identifier with an optional "= expr" initialiser */
+/* A declarator is an identifier with an optional "= expr" initialiser
+   (and in a1, an array of any number of dimensions) */
 declarator
-    : ID
-    | ID '=' expr
+    : ID                 { EVENT(seen, EVENT_DECLARATOR, @$, .name = $1);
+                           free($1); }
+    | ID '=' expr        { EVENT(seen, EVENT_DECLARATOR, @$, .name = $1);
+                           free($1); }
+%if a1
+    | ID dim_list
+        {
+            EVENT(seen, EVENT_DECLARATOR, @$, .name = $1);
+            declare_array(p, $1, $2);
+        }
+    | ID dim_list '=' expr
+        {
+            EVENT(seen, EVENT_DECLARATOR, @$, .name = $1);
+            declare_array(p, $1, $2);
+        }
+%endif
     ;
+%if a1
+
+/* One or more array dimension brackets: [N], [N][M], [N][M][P]... */
+dim_list
+    : '[' NUM ']'
+        {
+            EVENT(seen, EVENT_LITERAL, @2, .value = $2);
+            $$ = subscripts_new();
+            subscripts_push($$, literal_value($2));
+        }
+    | dim_list '[' NUM ']'
+        {
+            EVENT(seen, EVENT_LITERAL, @3, .value = $3);
+            $$ = $1;
+            subscripts_push($$, literal_value($3));
+        }
+    ;
+%endif
 
 /* ================================================================
    if / if-else
@@ -107,8 +347,14 @@ declarator
    binds to the nearest unmatched if.
    ================================================================ */
 if_stmt
-    : IF '(' expr ')' stmt %prec ELSE
-    | IF '(' expr ')' stmt ELSE stmt
+    : if_head '(' expr ')' stmt %prec ELSE
+                         { EVENT(exit, EVENT_IF, @$); }
+    | if_head '(' expr ')' stmt ELSE stmt
+                         { EVENT(exit, EVENT_IF, @$); }
+    ;
+
+if_head
+    : IF                 { EVENT(enter, EVENT_IF, @1); }
     ;
 
 /* ================================================================
@@ -116,63 +362,657 @@ if_stmt
    Example:  do { ... } while (expr);
    ================================================================ */
 do_while_stmt
-    : DO stmt WHILE '(' expr ')' ';'
+    : do_head stmt WHILE '(' expr ')' ';'
+                         { EVENT(exit, EVENT_DO_WHILE, @$); }
+    ;
+
+do_head
+    : DO                 { EVENT(enter, EVENT_DO_WHILE, @1); }
     ;
+%if a1
+
+/* ================================================================
+   while
+   ================================================================ */
+while_stmt
+    : while_head '(' expr ')' stmt
+                         { EVENT(exit, EVENT_WHILE, @$); }
+    ;
+
+while_head
+    : WHILE              { EVENT(enter, EVENT_WHILE, @1); }
+    ;
+
+/* ================================================================
+   for loop
+   Supports:
+     for (i=0; i<n; i++)
+     for (i=0, j=0; i<p && j<q; i++, j++)
+     for (;;)   (all parts optional)
+   ================================================================ */
+for_stmt
+    : for_head '(' for_init ';' for_cond ';' for_update ')' stmt
+                         { EVENT(exit, EVENT_FOR, @$); }
+    ;
+
+for_head
+    : FOR                { EVENT(enter, EVENT_FOR, @1); }
+    ;
+
+/* init: empty or comma-separated assignments / declarations */
+for_init
+    : /* empty */
+    | for_init_list
+    ;
+
+for_init_list
+    : for_init_item
+    | for_init_list ',' for_init_item
+    ;
+
+for_init_item
+    : ID '=' expr          { free($1); /* i=0              */ }
+    | type ID '=' expr     { EVENT(seen, EVENT_DECLARATOR, @$, .name = $2);
+                             free($2); /* int i=0 (C99)    */ }
+    | type ID              { EVENT(seen, EVENT_DECLARATOR, @$, .name = $2);
+                             free($2); /* int i            */ }
+    ;
+
+/* condition: empty or expression */
+for_cond
+    : /* empty */
+    | expr
+    ;
+
+/* update: empty or comma-separated update expressions */
+for_update
+    : /* empty */
+    | for_update_list
+    ;
+
+for_update_list
+    : for_update_item
+    | for_update_list ',' for_update_item
+    ;
+
+for_update_item
+    : ID INC               { free($1); /* i++      */ }
+    | ID DEC               { free($1); /* i--      */ }
+    | INC ID               { free($2); /* ++i      */ }
+    | DEC ID               { free($2); /* --i      */ }
+    | ID ADDASSIGN expr    { free($1); /* i += n   */ }
+    | ID SUBASSIGN expr    { free($1); /* i -= n   */ }
+    | ID '=' expr          { free($1); /* i = expr */ }
+    ;
+
+/* ================================================================
+   switch statement
+   switch (expr) {
+       case NUM : stmt_list
+       default  : stmt_list
+   }
+   ================================================================ */
+switch_stmt
+    : switch_head '(' expr ')' '{' case_list '}'
+                         { EVENT(exit, EVENT_SWITCH, @$); }
+    ;
+
+switch_head
+    : SWITCH             { EVENT(enter, EVENT_SWITCH, @1); }
+    ;
+
+case_list
+    : /* empty */
+    | case_list case_clause
+    ;
+
+case_clause
+    : CASE case_num ':' stmt_list
+    | CASE case_id  ':' stmt_list
+    | DEFAULT  ':' stmt_list
+    ;
+
+/* The label is seen before the statements under it */
+case_num
+    : NUM                { EVENT(seen, EVENT_LITERAL, @1, .value = $1); }
+    ;
+
+case_id
+    : ID                 { EVENT(seen, EVENT_NAME, @1, .name = $1);
+                           free($1); }
+    ;
+%endif
 
 /* ================================================================
    Block  { stmt_list }
    ================================================================ */
 block
-    : '{' stmt_list '}'
+    : block_head stmt_list '}'
+        {
+            EVENT(exit, EVENT_BLOCK, @$, .skipped = $1,
+                  .body = { @1.end, @3.begin });
+        }
+    ;
+
+/* Reduced as soon as the '{' is read: with lazy_blocks the scanner
+   moves to the '}' from here, and stmt_list is empty */
+block_head
+    : '{'
+        {
+            size_t close = @1.end;
+
+            $$ = p->lazy_blocks &&
+                 p->grammar->skip_block(p->scanner, &close);
+            EVENT(enter, EVENT_BLOCK, @1, .skipped = $$,
+                  .body = { @1.end, close });
+        }
     ;
 
 /* ================================================================
    Expression statement  (assignment or stand-alone expr)
    ================================================================ */
 expr_stmt
-    : ID '=' expr ';'    /* simple assignment */
-    | expr ';'           /* e.g. function call placeholder */
+    : ID '=' expr ';'    { ASSIGN("=", $1, @$); /* simple assignment */ }
+%if a1
+    | ID ADDASSIGN expr ';'     { ASSIGN("+=", $1, @$); }
+    | ID SUBASSIGN expr ';'     { ASSIGN("-=", $1, @$); }
+    | ID INC ';'                { ASSIGN("++", $1, @$); }
+    | ID DEC ';'                { ASSIGN("--", $1, @$); }
+%endif
+    | expr ';'           { EVENT(seen, EVENT_EXPR_STMT, @$);
+                           /* e.g. function call placeholder */ }
     ;
 
 /* ================================================================
    Expressions
-   Precedence is enforced via %left/%right directives above.
+   Precedence is enforced via %left/%right directives above; in a1
+   integer constants are folded as they reduce.
    ================================================================ */
 expr
     /* ── Arithmetic ── */
-    : expr '+' expr
-    | expr '-' expr
-    | expr '*' expr
-    | expr '/' expr
-    | expr '%' expr
+    : expr '+' expr      { OPERATOR("+", 2, @$);
+                           %a1{ $$ = fold('+', $1, $3); } }
+    | expr '-' expr      { OPERATOR("-", 2, @$);
+                           %a1{ $$ = fold('-', $1, $3); } }
+    | expr '*' expr      { OPERATOR("*", 2, @$);
+                           %a1{ $$ = fold('*', $1, $3); } }
+    | expr '/' expr      { OPERATOR("/", 2, @$);
+                           %a1{ $$ = fold('/', $1, $3); } }
+    | expr '%' expr      { OPERATOR("%", 2, @$);
+                           %a1{ $$ = fold('%', $1, $3); } }
 
     /* ── Relational ── */
-    | expr EQ  expr
-    | expr NEQ expr
-    | expr LT  expr
-    | expr GT  expr
-    | expr LE  expr
-    | expr GE  expr
+    | expr EQ  expr      { OPERATOR("==", 2, @$);
+                           %a1{ $$ = fold(EQ,  $1, $3); } }
+    | expr NEQ expr      { OPERATOR("!=", 2, @$);
+                           %a1{ $$ = fold(NEQ, $1, $3); } }
+    | expr LT  expr      { OPERATOR("<",  2, @$);
+                           %a1{ $$ = fold(LT,  $1, $3); } }
+    | expr GT  expr      { OPERATOR(">",  2, @$);
+                           %a1{ $$ = fold(GT,  $1, $3); } }
+    | expr LE  expr      { OPERATOR("<=", 2, @$);
+                           %a1{ $$ = fold(LE,  $1, $3); } }
+    | expr GE  expr      { OPERATOR(">=", 2, @$);
+                           %a1{ $$ = fold(GE,  $1, $3); } }
+%if a1
+
+    /* ── Logical ── */
+    | expr AND expr      { OPERATOR("&&", 2, @$);
+                           $$ = fold(AND, $1, $3); }
+    | expr OR  expr      { OPERATOR("||", 2, @$);
+                           $$ = fold(OR,  $1, $3); }
+%endif
 
     /* ── Unary minus ── */
     | '-' expr %prec UMINUS
+                         { OPERATOR("-", 1, @$);
+                           %a1{ $$ = fold(UMINUS, $2, UNKNOWN); } }
+%if a1
+    | '!' expr           { OPERATOR("!", 1, @$);
+                           $$ = fold('!', $2, UNKNOWN); }
+
+    /* ── Increment / decrement ── */
+    | ID INC             { INCDEC("++", $1, @$); $$ = UNKNOWN; }
+    | ID DEC             { INCDEC("--", $1, @$); $$ = UNKNOWN; }
+    | INC ID             { INCDEC("++", $2, @$); $$ = UNKNOWN; }
+    | DEC ID             { INCDEC("--", $2, @$); $$ = UNKNOWN; }
+
+    /* ── Array access: a[i], a[i][j] ── */
+    | ID index_list
+        {
+            EVENT(seen, EVENT_OPERATOR, @$, .name = $1, .op = "[]",
+                  .operands = $2->count);
+            check_subscripts(p, $1, $2);
+            free($1);
+            subscripts_free($2);
+            $$ = UNKNOWN;
+        }
+%endif
 
     /* ── Primary ── */
-    | '(' expr ')'
-    | ID
-    | NUM
+    | '(' expr ')'       %a1{ $$ = $2; }
+    | ID                 { EVENT(seen, EVENT_NAME, @1, .name = $1);
+                           free($1); %a1{ $$ = UNKNOWN; } }
+    | NUM                { EVENT(seen, EVENT_LITERAL, @1, .value = $1);
+                           %a1{ $$ = literal_value($1); } }
     ;
+%if a1
+
+/* One or more index brackets */
+index_list
+    : '[' expr ']'
+        { $$ = subscripts_new(); subscripts_push($$, $2); }
+    | index_list '[' expr ']'
+        { $$ = $1; subscripts_push($$, $3); }
+    ;
+%endif
 
 %%
 
+/* yyparse() is over: unused labels warn again (see yyoverflow) */
+#pragma GCC diagnostic pop
+
+/* ── flex's reentrant interface (lex_@dialect@.c) ── */
+#ifndef YY_TYPEDEF_YY_SCANNER_T
+#define YY_TYPEDEF_YY_SCANNER_T
+typedef void *yyscan_t;
+#endif
+
+struct yy_buffer_state;
+int   @dialect@_scan_token(YYSTYPE *lval, YYLTYPE *lloc, yyscan_t scanner);
+int   @dialect@_yylex_init_extra(struct parser *extra, yyscan_t *scanner);
+int   @dialect@_yylex_destroy(yyscan_t scanner);
+struct yy_buffer_state *@dialect@_yy_scan_buffer(char *base, size_t size,
+                                                 yyscan_t scanner);
+struct yy_buffer_state *@dialect@_yy_create_buffer(FILE *file, int size,
+                                                   yyscan_t scanner);
+void  @dialect@_yy_switch_to_buffer(struct yy_buffer_state *b,
+                                    yyscan_t scanner);
+void  @dialect@_yy_delete_buffer(struct yy_buffer_state *b,
+                                 yyscan_t scanner);
+char *@dialect@_yyget_text(yyscan_t scanner);
+struct parser *@dialect@_yyget_extra(yyscan_t scanner);
+size_t @dialect@_scan_offset(yyscan_t scanner);
+size_t @dialect@_scan_token_start(yyscan_t scanner);
+void  @dialect@_scan_hold(yyscan_t scanner, int nul);
+void  @dialect@_scan_release(yyscan_t scanner);
+void  @dialect@_scan_position(yyscan_t scanner, size_t offset,
+                              int *line, int *column);
+int   @dialect@_scan_skip_block(yyscan_t scanner, size_t *close);
+
+/* ================================================================
+   yylex – the scanner as seen by Bison, timed and counted for --stats
+   ================================================================ */
+
+/* The next of the tokens scanned ahead (tokens.h) */
+static int take(struct parser *p, YYSTYPE *lval, YYLTYPE *lloc) {
+    struct token_buf *t = p->ahead;
+    size_t i = tokens_take(t);
+
+    lloc->begin = t->offsets[i];
+    lloc->end   = lloc->begin + t->lengths[i];
+    if (t->kinds[i] == NUM)
+        lval->num = t->values[i];
+    return t->kinds[i];
+}
+
+/* The scanner only finds tokens (lexer.l): what it found wrong is
+   reported here, as each token reaches the parser */
+static void scan_error(struct parser *p) {
+    const char *text = parser_token_text(p);
+
+    if (strncmp(text, "/*", 2) == 0)
+        /* the line the comment starts on */
+        parser_diag(p, "Unterminated comment at line %d", parser_line(p));
+    else
+        parser_diag(p, "Syntax error at line %d, token : '%s'",
+                    parser_line(p), text);
+}
+
+int yylex(YYSTYPE *lval, YYLTYPE *lloc, struct parser *p) {
+    int token;
+
+    if (p->stats) {
+        uint64_t start = stats_cycles();
+        token = p->ahead ? take(p, lval, lloc)
+                         : @dialect@_scan_token(lval, lloc, p->scanner);
+        p->stats->lex_cycles += stats_cycles() - start;
+        stats_token(p->stats, YYTRANSLATE(token));
+    } else if (p->ahead) {
+        token = take(p, lval, lloc);
+    } else {
+        token = @dialect@_scan_token(lval, lloc, p->scanner);
+    }
+
+    switch (token) {
+    case ID:
+        lval->str = p->ahead
+            ? strndup(p->ahead->buf + lloc->begin, lloc->end - lloc->begin)
+            : strdup(@dialect@_yyget_text(p->scanner));
+        break;
+    case NUM:
+        /* a literal that does not fit is still a NUM: the parse goes on */
+        if (lval->num.overflow)
+            parser_diag(p, "%s constant out of range at line %d",
+                        lval->num.kind == NUMBER_INT ? "Integer"
+                                                     : "Floating",
+                        parser_line(p));
+        break;
+    case @DIALECT@_YYerror:
+        scan_error(p);
+        break;
+    }
+
+    /* Where the parse stopped, for on_top's caller */
+    if (p->on_top) {
+        p->tok_end    = p->ahead ? lloc->end
+                                 : @dialect@_scan_offset(p->scanner);
+        p->at_eof     = token == @DIALECT@_YYEOF;
+    }
+    return token;
+}
+
+/* ================================================================
+   Diagnostics
+   ================================================================ */
+
+/* Called by Bison on a syntax error */
+static int yyreport_syntax_error(const yypcontext_t *ctx, struct parser *p) {
+    yysymbol_kind_t kinds[YYNTOKENS];
+    int expected[YYNTOKENS];
+    int n = yypcontext_expected_tokens(ctx, kinds, YYNTOKENS);
+
+    for (int i = 0; i < n; i++)
+        expected[i] = kinds[i];
+    parser_syntax_error(p, yypcontext_location(ctx)->begin,
+                        yypcontext_token(ctx), expected, n < 0 ? 0 : n);
+    return 0;
+}
+
+/* Bison's own failures only: syntax errors take the path above */
+void yyerror(YYLTYPE *loc, struct parser *p, const char *msg) {
+    (void) msg;
+    parser_syntax_error(p, loc->begin, -1, NULL, 0);
+}
+
 /* ================================================================
-   main – drive the parse, report final verdict
+   grow_stacks – yyoverflow; on failure Bison aborts the parse
    ================================================================ */
-int main(void) {
-    int result = yyparse();
-    if (result == 0) {
-        printf("Syntax valid.\n");
+static void grow_stacks(struct parser *p,
+                        void **ss, size_t ss_bytes, size_t ss_elem,
+                        void **vs, size_t vs_bytes, size_t vs_elem,
+                        void **ls, size_t ls_bytes, size_t ls_elem,
+                        long *depth) {
+    switch (stacks_grow(&p->stacks, ss, ss_bytes, ss_elem,
+                        vs, vs_bytes, vs_elem, ls, ls_bytes, ls_elem,
+                        depth)) {
+    case STACKS_OK:
+        break;
+    case STACKS_LIMIT:
+        parser_diag(p,
+            "Nesting too deep at line %d: parser stack limit of %ld "
+            "reached (see --max-depth)",
+            parser_line(p), p->stacks.max_depth);
+        break;
+    case STACKS_NOMEM:
+        parser_diag(p, "Out of memory at line %d", parser_line(p));
+        break;
     }
-    /* yyerror() already printed the error message on failure */
+}
+
+/* ================================================================
+   The dialect as parser.c sees it (grammar.h)
+   ================================================================ */
+static int scanner_new(struct parser *p, void **scanner) {
+    return @dialect@_yylex_init_extra(p, scanner);
+}
+
+static void scanner_free(void *scanner) {
+    @dialect@_yylex_destroy(scanner);
+}
+
+/* Parse whatever the scanner's current buffer holds, or the tokens
+   scanned ahead if there are some (p->ahead) */
+static int parse_scanned(struct parser *p) {
+%if a1
+    /* rd.c fires no events (events.h) */
+    return p->rd && !p->visitor ? rd_parse(p) : yyparse(p);
+%else
+    return yyparse(p);
+%endif
+}
+
+static int parse(struct parser *p, char *buf, size_t len) {
+    struct yy_buffer_state *b;
+    int result;
+
+    b = @dialect@_yy_scan_buffer(buf, len + 2, p->scanner);
+    if (!b)
+        return -1;
+    result = parse_scanned(p);
+    @dialect@_scan_release(p->scanner);
+    @dialect@_yy_delete_buffer(b, p->scanner);
     return result;
 }
+
+/* The scanner's loop on its own, a batch of tokens at a time */
+static void scan_batch(void *scanner, struct token_buf *t) {
+    YYSTYPE val;
+    YYLTYPE loc;
+
+    for (size_t n = tokens_batch(t); n > 0; n--) {
+        size_t i = t->tail++ & t->mask;
+        int kind = @dialect@_scan_token(&val, &loc, scanner);
+
+        t->kinds[i]   = (uint16_t) kind;
+        t->offsets[i] = loc.begin;
+        t->lengths[i] = loc.end - loc.begin > UINT32_MAX
+                      ? UINT32_MAX : (uint32_t) (loc.end - loc.begin);
+        if (kind == NUM)
+            t->values[i] = val.num;
+        if (kind == @DIALECT@_YYEOF) {
+            t->ended = 1;
+            break;
+        }
+    }
+}
+
+/* flex reads (YY_INPUT, lexer.l) into a buffer of its own this size,
+   larger only for a token that does not fit */
+#define STREAM_BUF (128 * 1024)
+
+/* Scan buf[0..len) for tokens.c, located from base, while more() asks
+   for another batch; with no buf, what YY_INPUT reads instead */
+static int scan(void *scanner, char *buf, size_t len, size_t base,
+                struct token_buf *t,
+                int (*more)(void *ctx, struct token_buf *t), void *ctx) {
+    struct yy_buffer_state *b;
+    int ended;
+
+    if (buf) {
+        b = @dialect@_yy_scan_buffer(buf, len + 2, scanner);
+        if (!b)
+            return -1;
+    } else {
+        b = @dialect@_yy_create_buffer(NULL, STREAM_BUF, scanner);
+        @dialect@_yy_switch_to_buffer(b, scanner);
+    }
+    @dialect@_yyget_extra(scanner)->scan_base = base;
+    t->ended = 0;
+    do {
+        scan_batch(scanner, t);
+        if ((ended = t->ended))
+            t->tail--;
+    } while (more(ctx, t) && !ended);
+    @dialect@_scan_release(scanner);
+    @dialect@_yy_delete_buffer(b, scanner);
+    return 0;
+}
+
+static int parse_stream(struct parser *p) {
+    struct yy_buffer_state *b;
+    int result;
+
+    b = @dialect@_yy_create_buffer(NULL, STREAM_BUF, p->scanner);
+    @dialect@_yy_switch_to_buffer(b, p->scanner);
+    result = parse_scanned(p);
+    @dialect@_yy_delete_buffer(b, p->scanner);
+    return result;
+}
+
+static const char *token_text(void *scanner) {
+    return @dialect@_yyget_text(scanner);
+}
+
+static size_t token_start(void *scanner) {
+    return @dialect@_scan_token_start(scanner);
+}
+
+static void hold(void *scanner, int nul) {
+    @dialect@_scan_hold(scanner, nul);
+}
+
+static void stream_position(void *scanner, size_t offset,
+                            int *line, int *column) {
+    @dialect@_scan_position(scanner, offset, line, column);
+}
+
+static int skip_block(void *scanner, size_t *close) {
+    return @dialect@_scan_skip_block(scanner, close);
+}
+
+static const char *token_name(int kind) {
+    return yysymbol_name((yysymbol_kind_t) kind);
+}
+
+/* Rules are counted by their .output number (Bison's yyn - 1) */
+static const char *rule_name(int rule) {
+    return yysymbol_name((yysymbol_kind_t) yyr1[rule + 1]);
+}
+
+const struct grammar @dialect@_grammar = {
+    .name            = "@dialect@",
+    .ntokens         = YYNTOKENS,
+    .nrules          = YYNRULES,
+    .scanner_new     = scanner_new,
+    .scanner_free    = scanner_free,
+    .parse           = parse,
+    .parse_stream    = parse_stream,
+    .parse_ahead     = parse_scanned,
+    .scan_batch      = scan_batch,
+    .scan            = scan,
+    .token_text      = token_text,
+    .token_start     = token_start,
+    .hold            = hold,
+    .stream_position = stream_position,
+    .skip_block      = skip_block,
+    .token_name      = token_name,
+    .rule_name       = rule_name,
+};
+%if a1
+
+/* ================================================================
+   Constant folding
+   ================================================================ */
+
+/* Integer literals are constants; float literals are not subscripts,
+   and one out of range has been reported already */
+struct cexpr literal_value(struct number n) {
+    struct cexpr c = UNKNOWN;
+
+    if (n.kind == NUMBER_INT && !n.overflow) {
+        c.known = 1;
+        c.value = n.i;
+    }
+    return c;
+}
+
+/* Fold op over a (and b for binary ops); overflow and /0 stay unknown */
+struct cexpr fold(int op, struct cexpr a, struct cexpr b) {
+    struct cexpr r = UNKNOWN;
+    long x = a.value, y = b.value;
+
+    if (!a.known)
+        return r;
+    if (op == UMINUS) {
+        r.known = !__builtin_sub_overflow(0L, x, &r.value);
+        return r;
+    }
+    if (op == '!') {
+        r.known = 1;
+        r.value = !x;
+        return r;
+    }
+    if (!b.known)
+        return r;
+
+    r.known = 1;
+    switch (op) {
+    case '+': r.known = !__builtin_add_overflow(x, y, &r.value); break;
+    case '-': r.known = !__builtin_sub_overflow(x, y, &r.value); break;
+    case '*': r.known = !__builtin_mul_overflow(x, y, &r.value); break;
+    case '/':
+    case '%':
+        if (y == 0 || (x == LONG_MIN && y == -1))
+            r.known = 0;
+        else
+            r.value = op == '/' ? x / y : x % y;
+        break;
+    case EQ:  r.value = x == y; break;
+    case NEQ: r.value = x != y; break;
+    case LT:  r.value = x <  y; break;
+    case GT:  r.value = x >  y; break;
+    case LE:  r.value = x <= y; break;
+    case GE:  r.value = x >= y; break;
+    case AND: r.value = x && y; break;
+    case OR:  r.value = x || y; break;
+    default:  r.known = 0;      break;
+    }
+    return r;
+}
+
+/* ================================================================
+   Array declarations and subscripts (--check-bounds)
+   ================================================================ */
+void declare_array(struct parser *p, char *name,
+                   struct subscript_list *dims) {
+    if (p->check_bounds) {
+        for (int i = 0; i < dims->count; i++) {
+            const struct cexpr *d = &dims->items[i];
+            if (!d->known || d->value <= 0)
+                parser_diag(p, "Bounds error at line %d, dimension %d "
+                               "of '%s' is not a positive integer",
+                            parser_line(p), i + 1, name);
+        }
+    }
+    array_declare(&p->arrays, name, dims, parser_offset(p));
+    subscripts_free(dims);
+}
+
+void check_subscripts(struct parser *p, const char *name,
+                      const struct subscript_list *subs) {
+    const struct array_info *a;
+
+    if (!p->check_bounds || !(a = array_lookup(&p->arrays, name)))
+        return;
+    if (subs->count > a->rank) {
+        parser_diag(p, "Bounds error at line %d, '%s' has %d "
+                       "dimension(s), %d subscript(s) given",
+                    parser_line(p), name, a->rank, subs->count);
+        return;
+    }
+    /* each subscript against its own extent, never through the
+       strides: an array with no layout (size -1) is checked as far as
+       its extents are known */
+    for (int i = 0; i < subs->count; i++) {
+        const struct cexpr *s = &subs->items[i];
+        if (!s->known || a->dims[i] == 0)
+            continue;
+        if (s->value < 0 || s->value >= a->dims[i])
+            parser_diag(p, "Bounds error at line %d, index %ld out of "
+                           "range for dimension %d of '%s' [%ld]",
+                        parser_line(p), s->value, i + 1, name,
+                        a->dims[i]);
+    }
+}
+%endif
@@ -0,0 +1,456 @@
+/*
+ * rd.c - Recursive-descent / Pratt parser for the Assignment 1 grammar
+ *        (see rd.h)
+ *
+ * Each nonterminal of parser.y is a function; one token of lookahead
+ * picks the alternative.  The parse must reject the same inputs at the
+ * same token as the LALR parser, so where Bison resolves a conflict the
+ * code below makes the same choice:
+ *
+ *   - an ELSE belongs to the nearest IF (%prec ELSE);
+ *   - unary minus binds tighter than every binary operator (UMINUS);
+ *   - '!' has no precedence, so Bison shifts: its operand runs on over
+ *     every binary operator that follows ("!a + b" is "!(a + b)");
+ *   - "ID ++", "ID --" and "ID [...]" are taken whenever the token after
+ *     the ID allows it.
+ *
+ * A syntax error is reported like Bison's, with the scanner on the
+ * offending token, and ends the parse; so does an error the scanner has
+ * already reported.  All of the parse's state is in a struct rd on
+ * rd_parse()'s stack, so instances can run side by side; what the rules
+ * in progress own is chained from it (struct held), so that a failed
+ * parse frees it as Bison's %destructor would.
+ */
+
+#include <setjmp.h>
+#include <stdlib.h>
+
+#include "grammar.h"
+#include "parser_a1.tab.h"
+#include "rd.h"
+
+/* The a1 grammar's yylex (parser.y), timed and counted for --stats */
+int a1_yylex(A1_YYSTYPE *lval, A1_YYLTYPE *lloc, struct parser *p);
+
+static const struct cexpr UNKNOWN = { 0, 0 };
+
+/* What a rule in progress owns, in its caller's frame */
+struct held {
+    struct held           *up;
+    char                  *name;
+    struct subscript_list *subs;
+};
+
+struct rd {
+    struct parser *p;
+    int            tok;     /* the lookahead                            */
+    char          *tok_str; /* its text, for ID (owned by us)           */
+    A1_YYSTYPE     val;
+    A1_YYLTYPE     loc;     /* where the lookahead is                   */
+    size_t         end;     /* offset just past the token before it     */
+    struct held   *held;    /* innermost rule's belongings, or NULL     */
+    jmp_buf        failed;
+};
+
+static struct cexpr expr(struct rd *r);
+static void stmt(struct rd *r);
+
+/* ================================================================
+   Tokens
+   ================================================================ */
+
+static void hold(struct rd *r, struct held *h, char *name) {
+    h->up   = r->held;
+    h->name = name;
+    h->subs = NULL;
+    r->held = h;
+}
+
+static void release(struct rd *r, struct held *h) {
+    r->held = h->up;
+}
+
+/* End the parse, freeing the lookahead and every rule's belongings
+   (before the frames they are in are unwound) */
+static _Noreturn void fail(struct rd *r) {
+    free(r->tok_str);
+    for (struct held *h = r->held; h; h = h->up) {
+        free(h->name);
+        subscripts_free(h->subs);
+    }
+    longjmp(r->failed, 1);
+}
+
+static void next(struct rd *r) {
+    r->end = r->loc.end;
+    r->tok_str = NULL;
+    r->tok = a1_yylex(&r->val, &r->loc, r->p);
+    if (r->tok == A1_YYerror)               /* reported by the scanner */
+        fail(r);
+    if (r->tok == ID)
+        r->tok_str = r->val.str;
+}
+
+static _Noreturn void syntax_error(struct rd *r) {
+    parser_syntax_error(r->p, r->loc.begin, -1, NULL, 0);
+    fail(r);
+}
+
+static void expect(struct rd *r, int t) {
+    if (r->tok != t)
+        syntax_error(r);
+    next(r);
+}
+
+/* The text of an ID, which the caller frees or passes on */
+static char *take(struct rd *r, int t) {
+    char *s = r->tok_str;
+
+    if (r->tok != t)
+        syntax_error(r);
+    next(r);
+    return s;
+}
+
+/* The value of a NUM, as a constant if it is one */
+static struct cexpr take_number(struct rd *r) {
+    struct number n = r->val.num;
+
+    expect(r, NUM);
+    return literal_value(n);
+}
+
+static int is_type(int t) {
+    return t == INT || t == FLOAT || t == CHAR || t == DOUBLE;
+}
+
+static int starts_stmt(int t) {
+    switch (t) {
+    case INT: case FLOAT: case CHAR: case DOUBLE:
+    case IF: case DO: case WHILE: case FOR: case SWITCH: case BREAK:
+    case '{': case ID: case NUM: case '(': case '-': case '!':
+    case INC: case DEC:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/* ================================================================
+   Expressions
+   ================================================================ */
+
+/* Binding power of a binary operator, 0 if t is not one */
+static int precedence(int t) {
+    switch (t) {
+    case OR:                            return 1;
+    case AND:                           return 2;
+    case EQ: case NEQ:                  return 3;
+    case LT: case GT: case LE: case GE: return 4;
+    case '+': case '-':                 return 5;
+    case '*': case '/': case '%':       return 6;
+    default:                            return 0;
+    }
+}
+
+/* What may follow an ID in an expression: ++, --, or subscripts */
+static struct cexpr id_tail(struct rd *r, char *name) {
+    struct held h;
+
+    hold(r, &h, name);
+    if (r->tok == INC || r->tok == DEC) {
+        next(r);
+    } else if (r->tok == '[') {
+        h.subs = subscripts_new();
+        do {
+            next(r);
+            subscripts_push(h.subs, expr(r));
+            expect(r, ']');
+        } while (r->tok == '[');
+        check_subscripts(r->p, name, h.subs);
+        subscripts_free(h.subs);
+    }
+    release(r, &h);
+    free(name);
+    return UNKNOWN;
+}
+
+/* An operand: a primary, or a prefix operator and its operand */
+static struct cexpr unary(struct rd *r) {
+    struct cexpr v;
+
+    switch (r->tok) {
+    case '-':
+        next(r);
+        return fold(UMINUS, unary(r), UNKNOWN);
+    case '!':
+        next(r);
+        return fold('!', expr(r), UNKNOWN);
+    case INC:
+    case DEC:
+        next(r);
+        free(take(r, ID));
+        return UNKNOWN;
+    case '(':
+        next(r);
+        v = expr(r);
+        expect(r, ')');
+        return v;
+    case NUM:
+        return take_number(r);
+    case ID:
+        return id_tail(r, take(r, ID));
+    default:
+        syntax_error(r);
+    }
+}
+
+/* Fold the binary operators of at least min's binding power into lhs;
+   all are left-associative */
+static struct cexpr binary(struct rd *r, struct cexpr lhs, int min) {
+    int prec;
+
+    while ((prec = precedence(r->tok)) >= min) {
+        int op = r->tok;
+        next(r);
+        lhs = fold(op, lhs, binary(r, unary(r), prec + 1));
+    }
+    return lhs;
+}
+
+static struct cexpr expr(struct rd *r) {
+    return binary(r, unary(r), 1);
+}
+
+/* ================================================================
+   Declarations
+   ================================================================ */
+
+static void declarator(struct rd *r) {
+    struct held h;
+
+    hold(r, &h, take(r, ID));
+    if (r->tok != '[') {
+        if (r->tok == '=') {
+            next(r);
+            expr(r);
+        }
+        release(r, &h);
+        free(h.name);
+        return;
+    }
+
+    h.subs = subscripts_new();
+    do {
+        next(r);
+        subscripts_push(h.subs, take_number(r));
+        expect(r, ']');
+    } while (r->tok == '[');
+    if (r->tok == '=') {
+        next(r);
+        expr(r);
+    }
+    release(r, &h);
+    declare_array(r->p, h.name, h.subs);
+}
+
+static void decl_stmt(struct rd *r) {
+    next(r);                             /* the type */
+    declarator(r);
+    while (r->tok == ',') {
+        next(r);
+        declarator(r);
+    }
+    expect(r, ';');
+}
+
+/* ================================================================
+   Statements
+   ================================================================ */
+
+static void stmt_list(struct rd *r) {
+    while (starts_stmt(r->tok))
+        stmt(r);
+}
+
+static void for_init_item(struct rd *r) {
+    if (is_type(r->tok)) {
+        next(r);
+        free(take(r, ID));
+        if (r->tok != '=')
+            return;
+    } else {
+        free(take(r, ID));
+        if (r->tok != '=')
+            syntax_error(r);
+    }
+    next(r);
+    expr(r);
+}
+
+static void for_update_item(struct rd *r) {
+    if (r->tok == INC || r->tok == DEC) {
+        next(r);
+        free(take(r, ID));
+        return;
+    }
+    free(take(r, ID));
+    switch (r->tok) {
+    case INC:
+    case DEC:
+        next(r);
+        break;
+    case ADDASSIGN:
+    case SUBASSIGN:
+    case '=':
+        next(r);
+        expr(r);
+        break;
+    default:
+        syntax_error(r);
+    }
+}
+
+static void for_stmt(struct rd *r) {
+    next(r);
+    expect(r, '(');
+    if (r->tok != ';') {
+        for_init_item(r);
+        while (r->tok == ',') {
+            next(r);
+            for_init_item(r);
+        }
+    }
+    expect(r, ';');
+    if (r->tok != ';')
+        expr(r);
+    expect(r, ';');
+    if (r->tok != ')') {
+        for_update_item(r);
+        while (r->tok == ',') {
+            next(r);
+            for_update_item(r);
+        }
+    }
+    expect(r, ')');
+    stmt(r);
+}
+
+static void switch_stmt(struct rd *r) {
+    next(r);
+    expect(r, '(');
+    expr(r);
+    expect(r, ')');
+    expect(r, '{');
+    while (r->tok == CASE || r->tok == DEFAULT) {
+        if (r->tok == CASE) {
+            next(r);
+            if (r->tok != NUM && r->tok != ID)
+                syntax_error(r);
+            free(r->tok_str);
+        }
+        next(r);
+        expect(r, ':');
+        stmt_list(r);
+    }
+    expect(r, '}');
+}
+
+/* An expression statement starting with an ID: an assignment, or an
+   expression whose first operand is that ID */
+static void id_stmt(struct rd *r) {
+    char *name = take(r, ID);
+
+    if (r->tok == '=' || r->tok == ADDASSIGN || r->tok == SUBASSIGN) {
+        free(name);
+        next(r);
+        expr(r);
+    } else {
+        binary(r, id_tail(r, name), 1);
+    }
+    expect(r, ';');
+}
+
+static void stmt(struct rd *r) {
+    switch (r->tok) {
+    case INT: case FLOAT: case CHAR: case DOUBLE:
+        decl_stmt(r);
+        break;
+    case IF:
+        next(r);
+        expect(r, '(');
+        expr(r);
+        expect(r, ')');
+        stmt(r);
+        if (r->tok == ELSE) {
+            next(r);
+            stmt(r);
+        }
+        break;
+    case DO:
+        next(r);
+        stmt(r);
+        expect(r, WHILE);
+        expect(r, '(');
+        expr(r);
+        expect(r, ')');
+        expect(r, ';');
+        break;
+    case WHILE:
+        next(r);
+        expect(r, '(');
+        expr(r);
+        expect(r, ')');
+        stmt(r);
+        break;
+    case FOR:
+        for_stmt(r);
+        break;
+    case SWITCH:
+        switch_stmt(r);
+        break;
+    case '{': {
+        size_t close;
+
+        /* lazy_blocks: the scanner is just past the '{' */
+        if (r->p->lazy_blocks)
+            r->p->grammar->skip_block(r->p->scanner, &close);
+        next(r);
+        stmt_list(r);
+        expect(r, '}');
+        break;
+    }
+    case BREAK:
+        next(r);
+        expect(r, ';');
+        break;
+    case ID:
+        id_stmt(r);
+        break;
+    default:
+        expr(r);
+        expect(r, ';');
+        break;
+    }
+}
+
+/* ================================================================
+   Entry point
+   ================================================================ */
+int rd_parse(struct parser *p) {
+    struct rd rd = { .p = p };
+    struct rd *r = &rd;
+
+    if (setjmp(r->failed))
+        return 1;
+    next(r);
+    /* the program's own statements, reported as parser.y's top_list */
+    while (starts_stmt(r->tok)) {
+        stmt(r);
+        if (p->on_top && p->on_top(p, r->end))
+            return 0;
+    }
+    if (r->tok != 0)
+        syntax_error(r);
+    return 0;
+}
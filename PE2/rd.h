@@ -0,0 +1,30 @@
+/*
+ * rd.h - Hand-written parser for the a1 dialect (--parser=rd)
+ *
+ * rd_parse() accepts exactly the language of parser.y's a1 dialect and
+ * runs the same actions (constant folding, array declarations,
+ * --check-bounds) at the same points, reading tokens from the same flex
+ * scanner.  Statements are parsed by recursive descent, expressions by
+ * precedence climbing (Pratt), with one function call per operator
+ * instead of one trip through Bison's tables per precedence level.
+ */
+
+#ifndef RD_H
+#define RD_H
+
+#include "arrays.h"
+#include "number.h"
+#include "parser.h"
+
+/* Parse p's buffer like yyparse(): 0 if valid, 1 on a syntax error */
+int rd_parse(struct parser *p);
+
+/* ── Defined in parser.y (a1), shared by both parsers ── */
+struct cexpr literal_value(struct number n);
+struct cexpr fold(int op, struct cexpr a, struct cexpr b);
+void declare_array(struct parser *p, char *name,
+                   struct subscript_list *dims);
+void check_subscripts(struct parser *p, const char *name,
+                      const struct subscript_list *subs);
+
+#endif /* RD_H */
@@ -0,0 +1,72 @@
+/*
+ * stacks.c - Growable parser stacks backed by a reusable arena
+ */
+
+#include "stacks.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Make buf hold at least need bytes and move the live stack into it */
+static int relocate(struct stack_buf *buf, void **stack, size_t used,
+                    size_t need) {
+    if (*stack == buf->data) {
+        if (buf->cap < need) {
+            void *p = realloc(buf->data, need);     /* keeps contents */
+            if (!p)
+                return 0;
+            buf->data = p;
+            buf->cap  = need;
+        }
+    } else {
+        /* First growth in this parse: still on yyparse()'s arrays */
+        if (buf->cap < need) {
+            void *p = malloc(need);
+            if (!p)
+                return 0;
+            free(buf->data);
+            buf->data = p;
+            buf->cap  = need;
+        }
+        memcpy(buf->data, *stack, used);
+    }
+    *stack = buf->data;
+    return 1;
+}
+
+enum stacks_status stacks_grow(struct stack_arena *arena,
+                               void **ss, size_t ss_bytes, size_t ss_elem,
+                               void **vs, size_t vs_bytes, size_t vs_elem,
+                               void **ls, size_t ls_bytes, size_t ls_elem,
+                               long *depth) {
+    long limit = arena->max_depth;
+    long n = *depth;
+
+    if (limit && n >= limit)
+        return STACKS_LIMIT;
+    if (n > LONG_MAX / 2)
+        return STACKS_NOMEM;
+    n *= 2;
+    if (limit && n > limit)
+        n = limit;
+    if ((size_t) n > SIZE_MAX / vs_elem || (size_t) n > SIZE_MAX / ls_elem)
+        return STACKS_NOMEM;
+
+    if (!relocate(&arena->state, ss, ss_bytes, n * ss_elem) ||
+        !relocate(&arena->value, vs, vs_bytes, n * vs_elem) ||
+        !relocate(&arena->loc,   ls, ls_bytes, n * ls_elem))
+        return STACKS_NOMEM;
+
+    *depth = n;
+    return STACKS_OK;
+}
+
+void stacks_free(struct stack_arena *arena) {
+    free(arena->state.data);
+    free(arena->value.data);
+    free(arena->loc.data);
+    arena->state.data = arena->value.data = arena->loc.data = NULL;
+    arena->state.cap  = arena->value.cap  = arena->loc.cap  = 0;
+}
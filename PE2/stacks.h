@@ -0,0 +1,55 @@
+/*
+ * stacks.h - Growable parser stacks backed by a reusable arena
+ *
+ * Bison starts every parse on small stacks local to yyparse() and, by
+ * default, doubles them on the heap up to a compiled-in YYMAXDEPTH of
+ * 10000, failing with "memory exhausted" beyond that.  parser.y instead
+ * defines yyoverflow so that the stacks move into a stack_arena, which
+ * grows geometrically up to a run-time limit (--max-depth) and is kept
+ * between parses: once an input has needed deep stacks, later parses
+ * reuse the same memory without calling malloc again.
+ */
+
+#ifndef STACKS_H
+#define STACKS_H
+
+#include <stddef.h>
+
+/* Default limit on parser stack entries (0 means no limit) */
+#define DEFAULT_MAX_DEPTH 10000000L
+
+struct stack_buf {
+    void   *data;
+    size_t  cap;        /* bytes */
+};
+
+struct stack_arena {
+    struct stack_buf state;     /* yyss */
+    struct stack_buf value;     /* yyvs */
+    struct stack_buf loc;       /* yyls */
+    long             max_depth; /* entries, 0 = unlimited */
+};
+
+enum stacks_status {
+    STACKS_OK = 0,
+    STACKS_LIMIT,               /* max_depth reached      */
+    STACKS_NOMEM                /* allocation failed      */
+};
+
+/*
+ * Grow the three parser stacks to the next size.  *ss, *vs and *ls point
+ * at the stacks in use (Bison's local arrays or arena memory) holding
+ * the given number of bytes; each pointer is updated as soon as its
+ * stack moves, so they stay valid even when a later one fails.  *depth
+ * is the current capacity in entries and is only raised on STACKS_OK.
+ */
+enum stacks_status stacks_grow(struct stack_arena *arena,
+                               void **ss, size_t ss_bytes, size_t ss_elem,
+                               void **vs, size_t vs_bytes, size_t vs_elem,
+                               void **ls, size_t ls_bytes, size_t ls_elem,
+                               long *depth);
+
+/* Release the arena's memory */
+void stacks_free(struct stack_arena *arena);
+
+#endif /* STACKS_H */
@@ -0,0 +1,121 @@
+/*
+ * stats.c - Parse-time statistics report (see stats.h)
+ */
+
+#include "stats.h"
+
+#include <stdlib.h>
+
+#include "strbuf.h"
+
+void stats_begin(struct parse_stats *s, int ntokens, int nrules,
+                 const char *(*token_name)(int kind),
+                 const char *(*rule_name)(int rule)) {
+    s->ntokens      = ntokens;
+    s->nrules       = nrules;
+    s->token_name   = token_name;
+    s->rule_name    = rule_name;
+    s->token_counts = xcalloc(ntokens, sizeof *s->token_counts);
+    s->rule_counts  = xcalloc(nrules, sizeof *s->rule_counts);
+    clock_gettime(CLOCK_MONOTONIC, &s->start_time);
+    s->start_cycles = stats_cycles();
+}
+
+void stats_end(struct parse_stats *s) {
+    s->end_cycles = stats_cycles();
+    clock_gettime(CLOCK_MONOTONIC, &s->end_time);
+}
+
+void stats_merge(struct parse_stats *s, const struct parse_stats *from) {
+    for (int i = 0; i < s->ntokens; i++)
+        s->token_counts[i] += from->token_counts[i];
+    for (int i = 0; i < s->nrules; i++)
+        s->rule_counts[i] += from->rule_counts[i];
+    if (from->max_depth > s->max_depth)
+        s->max_depth = from->max_depth;
+    s->bytes      += from->bytes;
+    s->lex_cycles += from->lex_cycles;
+}
+
+/* Sort helper: indices into the counter array being reported */
+static const unsigned long *sort_counts;
+
+static int by_count_desc(const void *a, const void *b) {
+    unsigned long x = sort_counts[*(const int *) a];
+    unsigned long y = sort_counts[*(const int *) b];
+    if (x != y)
+        return x < y ? 1 : -1;
+    return *(const int *) a - *(const int *) b;
+}
+
+/* Print the non-zero entries of counts[], largest first */
+static void report_counts(FILE *out, const unsigned long *counts, int n,
+                          const char *(*name)(int), int show_index) {
+    int *order = malloc(n * sizeof *order);
+    if (!order)
+        return;
+    for (int i = 0; i < n; i++)
+        order[i] = i;
+    sort_counts = counts;
+    qsort(order, n, sizeof *order, by_count_desc);
+
+    for (int i = 0; i < n && counts[order[i]]; i++) {
+        if (show_index)
+            fprintf(out, "  %10lu  %4d  %s\n",
+                    counts[order[i]], order[i], name(order[i]));
+        else
+            fprintf(out, "  %10lu  %s\n", counts[order[i]], name(order[i]));
+    }
+    free(order);
+}
+
+void stats_report(const struct parse_stats *s, FILE *out) {
+    double wall = (s->end_time.tv_sec - s->start_time.tv_sec)
+                + (s->end_time.tv_nsec - s->start_time.tv_nsec) / 1e9;
+    uint64_t total = s->end_cycles - s->start_cycles;
+    uint64_t work = total;      /* lexer + parser: all threads' time */
+    double per_cycle = total ? wall / (double) total : 0.0;
+    unsigned long ntok = 0;
+
+    for (int i = 0; i < s->ntokens; i++)
+        ntok += s->token_counts[i];
+    if (s->nworkers) {
+        work = 0;
+        for (int i = 0; i < s->nworkers; i++)
+            work += s->workers[i].busy_cycles;
+    }
+    uint64_t parse = work > s->lex_cycles ? work - s->lex_cycles : 0;
+
+    fprintf(out, "=== Parse statistics ===\n");
+    fprintf(out, "Input bytes      : %lu\n", s->bytes);
+    if (s->files)
+        fprintf(out, "Input files      : %lu  (%s)\n", s->files, s->io);
+    fprintf(out, "Tokens           : %lu\n", ntok);
+    fprintf(out, "Max stack depth  : %ld\n", s->max_depth);
+    fprintf(out, "Total time       : %.6f s  (%llu cycles)\n",
+            wall, (unsigned long long) total);
+    fprintf(out, "  lexer          : %.6f s  (%5.1f%%)\n",
+            s->lex_cycles * per_cycle,
+            work ? 100.0 * s->lex_cycles / work : 0.0);
+    fprintf(out, "  parser         : %.6f s  (%5.1f%%)\n",
+            parse * per_cycle, work ? 100.0 * parse / work : 0.0);
+    fprintf(out, "Throughput       : %.2f MB/s\n",
+            wall > 0 ? s->bytes / wall / 1e6 : 0.0);
+
+    if (s->nworkers) {
+        fprintf(out, "\nWorkers (busy / wall time):\n");
+        for (int i = 0; i < s->nworkers; i++) {
+            const struct worker_stats *w = &s->workers[i];
+            fprintf(out, "  %4d  %5.1f%%  %8lu tasks  %8lu stolen\n", i,
+                    total ? 100.0 * w->busy_cycles / total : 0.0,
+                    w->tasks, w->stolen);
+        }
+    }
+
+    fprintf(out, "\nTokens by kind:\n");
+    report_counts(out, s->token_counts, s->ntokens, s->token_name, 0);
+
+    fprintf(out, "\nReductions by rule (numbered as in the dialect's "
+                 "parser_*.output):\n");
+    report_counts(out, s->rule_counts, s->nrules, s->rule_name, 1);
+}
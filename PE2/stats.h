@@ -0,0 +1,88 @@
+/*
+ * stats.h - Parse-time statistics (--stats)
+ *
+ * Each parser instance points at the parse_stats it counts into, or at
+ * NULL, so the cost of the hooks with the flag off is one predictable
+ * branch per token and per reduction.  Timings come from the CPU
+ * time-stamp counter and are converted to seconds by calibrating
+ * against CLOCK_MONOTONIC over the whole run.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/* One scheduler thread's share of a parallel run (see steal.c) */
+struct worker_stats {
+    unsigned long  tasks;         /* tasks run             */
+    unsigned long  stolen;        /* ... taken from others */
+    uint64_t       busy_cycles;   /* spent running them    */
+};
+
+struct parse_stats {
+    int            ntokens;       /* size of token_counts  */
+    int            nrules;        /* size of rule_counts   */
+    unsigned long *token_counts;  /* by token symbol kind  */
+    unsigned long *rule_counts;   /* by Bison rule number  */
+    const char  *(*token_name)(int kind);  /* names of both, */
+    const char  *(*rule_name)(int rule);   /*   for the report */
+    long           max_depth;     /* deepest parser stack  */
+    unsigned long  bytes;         /* input bytes scanned   */
+    unsigned long  files;         /* input files, if any   */
+    const char    *io;            /* how they were read    */
+    int            nworkers;      /* threads, if parallel  */
+    const struct worker_stats *workers;
+
+    uint64_t       lex_cycles;    /* spent inside yylex    */
+    uint64_t       start_cycles;
+    uint64_t       end_cycles;
+    struct timespec start_time;
+    struct timespec end_time;
+};
+
+/* Time-stamp counter, or nanoseconds where there is none */
+static inline uint64_t stats_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+#endif
+}
+
+/* Called from the parser hooks (only when counting) */
+static inline void stats_token(struct parse_stats *s, int kind) {
+    s->token_counts[kind]++;
+}
+
+static inline void stats_reduce(struct parse_stats *s, int rule,
+                                long depth) {
+    s->rule_counts[rule]++;
+    if (depth > s->max_depth)
+        s->max_depth = depth;
+}
+
+/* Allocate the counters for a grammar of these sizes and names, and
+   start the clock */
+void stats_begin(struct parse_stats *s, int ntokens, int nrules,
+                 const char *(*token_name)(int kind),
+                 const char *(*rule_name)(int rule));
+
+/* Stop the clock */
+void stats_end(struct parse_stats *s);
+
+/* Add the counters of another instance's stats (same sizes) into s */
+void stats_merge(struct parse_stats *s, const struct parse_stats *from);
+
+/* Print the report */
+void stats_report(const struct parse_stats *s, FILE *out);
+
+#endif /* STATS_H */
@@ -0,0 +1,329 @@
+/*
+ * steal.c - Work-stealing task scheduler (see steal.h)
+ *
+ * The deque is the Chase-Lev one, with the C11 memory orderings of
+ * Lê, Pop, Cohen and Zappa Nardelli, "Correct and Efficient
+ * Work-Stealing for Weak Memory Models" (PPoPP 2013).  When a deque
+ * fills up its owner copies it into one twice the size; thieves may
+ * still be reading the old array, so old arrays are only freed with
+ * the scheduler.
+ *
+ * A worker with nothing to do tries again SPIN_TRIES times, then sleeps
+ * on the scheduler's condition variable.  It counts itself in sleeping
+ * before it looks at the deques and at pending one last time, and
+ * sched_push() (or the worker finishing the last task) looks at
+ * sleeping after its own update, both with a full fence in between: one
+ * of the two always sees the other, so no wakeup is lost.  The mutex
+ * is only taken to sleep and to wake sleepers.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "steal.h"
+#include "strbuf.h"
+
+#define DEQUE_MIN   64          /* initial slots, a power of two     */
+#define ABORT       ((void *) 1)    /* steal lost a race: try again  */
+#define SPIN_TRIES  64          /* idle rounds before a worker sleeps */
+
+struct deque_array {
+    long                 size;      /* a power of two               */
+    struct deque_array  *prev;      /* outgrown, freed with the deque */
+    _Atomic(void *)      slot[];
+};
+
+struct deque {
+    _Alignas(64) atomic_long     top;       /* thieves take here     */
+    _Alignas(64) atomic_long     bottom;    /* the owner works here  */
+    _Atomic(struct deque_array *) array;
+};
+
+struct worker {
+    struct sched        *sched;
+    int                  id;
+    uint64_t             rand;      /* xorshift state, picks victims */
+    pthread_t            thread;
+    int                  started;
+    struct deque         deque;
+    struct worker_stats  stats;
+};
+
+struct sched {
+    int                  nworkers;
+    struct worker       *workers;
+    struct worker_stats *stats;     /* copied out after a run        */
+    atomic_long          pending;   /* pushed and not yet finished   */
+    atomic_int           sleeping;  /* workers waiting on wake       */
+    pthread_mutex_t      lock;
+    pthread_cond_t       wake;      /* a push, or pending reached 0  */
+    sched_fn            *fn;
+    void                *ctx;
+};
+
+/* ================================================================
+   Chase-Lev deque
+   ================================================================ */
+
+static struct deque_array *array_new(long size) {
+    struct deque_array *a = xmalloc(sizeof *a + size * sizeof a->slot[0]);
+    a->size = size;
+    a->prev = NULL;
+    return a;
+}
+
+/* The owner's deque is full: copy the live range into one twice the size */
+static struct deque_array *grow(struct deque *d, struct deque_array *a,
+                                long top, long bottom) {
+    struct deque_array *b = array_new(2 * a->size);
+
+    for (long i = top; i < bottom; i++)
+        atomic_store_explicit(&b->slot[i & (b->size - 1)],
+            atomic_load_explicit(&a->slot[i & (a->size - 1)],
+                                 memory_order_relaxed),
+            memory_order_relaxed);
+    b->prev = a;
+    atomic_store_explicit(&d->array, b, memory_order_release);
+    return b;
+}
+
+/* Owner only */
+static void deque_push(struct deque *d, void *task) {
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    long t = atomic_load_explicit(&d->top, memory_order_acquire);
+    struct deque_array *a = atomic_load_explicit(&d->array,
+                                                 memory_order_relaxed);
+
+    if (b - t > a->size - 1)
+        a = grow(d, a, t, b);
+    atomic_store_explicit(&a->slot[b & (a->size - 1)], task,
+                          memory_order_relaxed);
+    /* a release store rather than the paper's fence: the same code on
+       x86, and one ThreadSanitizer understands */
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_release);
+}
+
+/* Owner only: the task pushed last, or NULL */
+static void *deque_take(struct deque *d) {
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    struct deque_array *a = atomic_load_explicit(&d->array,
+                                                 memory_order_relaxed);
+    void *task = NULL;
+    long t;
+
+    atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    t = atomic_load_explicit(&d->top, memory_order_relaxed);
+    if (t <= b) {
+        task = atomic_load_explicit(&a->slot[b & (a->size - 1)],
+                                    memory_order_relaxed);
+        if (t == b) {
+            /* the last one: race the thieves for it */
+            if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1,
+                    memory_order_seq_cst, memory_order_relaxed))
+                task = NULL;
+            atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        }
+    } else {
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    }
+    return task;
+}
+
+/* Any thread: the oldest task, NULL if empty, ABORT on a lost race */
+static void *deque_steal(struct deque *d) {
+    long t = atomic_load_explicit(&d->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+
+    if (t >= b)
+        return NULL;
+    struct deque_array *a = atomic_load_explicit(&d->array,
+                                                 memory_order_acquire);
+    void *task = atomic_load_explicit(&a->slot[t & (a->size - 1)],
+                                      memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1,
+            memory_order_seq_cst, memory_order_relaxed))
+        return ABORT;
+    return task;
+}
+
+/* ================================================================
+   Workers
+   ================================================================ */
+
+static uint64_t next_rand(struct worker *w) {
+    w->rand ^= w->rand << 13;
+    w->rand ^= w->rand >> 7;
+    w->rand ^= w->rand << 17;
+    return w->rand;
+}
+
+/* A task from some other worker's deque, starting at a random one */
+static void *steal(struct worker *w) {
+    struct sched *s = w->sched;
+    int first = (int) (next_rand(w) % (uint64_t) s->nworkers);
+
+    for (int i = 0; i < s->nworkers; i++) {
+        struct worker *v = &s->workers[(first + i) % s->nworkers];
+        void *task;
+
+        if (v == w)
+            continue;
+        while ((task = deque_steal(&v->deque)) == ABORT)
+            ;
+        if (task)
+            return task;
+    }
+    return NULL;
+}
+
+/* Any deque with a task in it (bottom past top) */
+static int any_task(struct sched *s) {
+    for (int i = 0; i < s->nworkers; i++) {
+        struct deque *d = &s->workers[i].deque;
+        if (atomic_load_explicit(&d->bottom, memory_order_relaxed) >
+            atomic_load_explicit(&d->top, memory_order_relaxed))
+            return 1;
+    }
+    return 0;
+}
+
+/* Sleep until there may be work, or none is pending */
+static void park(struct sched *s) {
+    pthread_mutex_lock(&s->lock);
+    atomic_fetch_add_explicit(&s->sleeping, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&s->pending, memory_order_relaxed) != 0 &&
+        !any_task(s))
+        pthread_cond_wait(&s->wake, &s->lock);
+    atomic_fetch_sub_explicit(&s->sleeping, 1, memory_order_relaxed);
+    pthread_mutex_unlock(&s->lock);
+}
+
+/* After a push or the last task's end: wake the sleepers, if any */
+static void wake(struct sched *s, int all) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&s->sleeping, memory_order_relaxed) == 0)
+        return;
+    pthread_mutex_lock(&s->lock);
+    if (all)
+        pthread_cond_broadcast(&s->wake);
+    else
+        pthread_cond_signal(&s->wake);
+    pthread_mutex_unlock(&s->lock);
+}
+
+static void *work(void *arg) {
+    struct worker *w = arg;
+    struct sched *s = w->sched;
+    int idle = 0;
+
+    for (;;) {
+        void *task = deque_take(&w->deque);
+        if (!task && (task = steal(w)) != NULL)
+            w->stats.stolen++;
+        if (!task) {
+            if (atomic_load_explicit(&s->pending, memory_order_acquire) == 0)
+                break;
+            if (++idle < SPIN_TRIES) {
+                sched_yield();      /* others still running: they may
+                                       push more */
+            } else {
+                park(s);
+                idle = 0;
+            }
+            continue;
+        }
+        idle = 0;
+        uint64_t start = stats_cycles();
+        s->fn(s, w->id, task, s->ctx);
+        w->stats.busy_cycles += stats_cycles() - start;
+        w->stats.tasks++;
+        if (atomic_fetch_sub_explicit(&s->pending, 1,
+                                      memory_order_acq_rel) == 1)
+            wake(s, 1);
+    }
+    return NULL;
+}
+
+/* ================================================================
+   Public interface
+   ================================================================ */
+
+struct sched *sched_new(int nworkers) {
+    struct sched *s = xcalloc(1, sizeof *s);
+
+    if (nworkers < 1)
+        nworkers = 1;
+    s->workers = xcalloc(nworkers, sizeof *s->workers);
+    s->stats   = xcalloc(nworkers, sizeof *s->stats);
+    s->nworkers = nworkers;
+    for (int i = 0; i < nworkers; i++) {
+        struct worker *w = &s->workers[i];
+        w->sched = s;
+        w->id    = i;
+        w->rand  = 0x9e3779b97f4a7c15ULL * (uint64_t) (i + 1);
+        atomic_init(&w->deque.top, 0);
+        atomic_init(&w->deque.bottom, 0);
+        atomic_init(&w->deque.array, array_new(DEQUE_MIN));
+    }
+    atomic_init(&s->pending, 0);
+    atomic_init(&s->sleeping, 0);
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->wake, NULL);
+    return s;
+}
+
+void sched_push(struct sched *s, int worker, void *task) {
+    /* counted before it can be taken, so pending never reads 0 early */
+    atomic_fetch_add_explicit(&s->pending, 1, memory_order_relaxed);
+    deque_push(&s->workers[worker].deque, task);
+    wake(s, 0);
+}
+
+void sched_run(struct sched *s, sched_fn *fn, void *ctx) {
+    s->fn  = fn;
+    s->ctx = ctx;
+    for (int i = 0; i < s->nworkers; i++) {
+        struct worker *w = &s->workers[i];
+        w->stats = (struct worker_stats) { 0 };
+        w->started = 0;
+    }
+    for (int i = 1; i < s->nworkers; i++) {
+        struct worker *w = &s->workers[i];
+        w->started = pthread_create(&w->thread, NULL, work, w) == 0;
+    }
+    work(&s->workers[0]);
+    for (int i = 1; i < s->nworkers; i++)
+        if (s->workers[i].started)
+            pthread_join(s->workers[i].thread, NULL);
+    for (int i = 0; i < s->nworkers; i++)
+        s->stats[i] = s->workers[i].stats;
+}
+
+const struct worker_stats *sched_stats(const struct sched *s) {
+    return s->stats;
+}
+
+void sched_free(struct sched *s) {
+    if (!s)
+        return;
+    for (int i = 0; i < s->nworkers; i++) {
+        struct deque_array *a = atomic_load(&s->workers[i].deque.array);
+        while (a) {
+            struct deque_array *prev = a->prev;
+            free(a);
+            a = prev;
+        }
+    }
+    pthread_mutex_destroy(&s->lock);
+    pthread_cond_destroy(&s->wake);
+    free(s->workers);
+    free(s->stats);
+    free(s);
+}
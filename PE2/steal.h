@@ -0,0 +1,39 @@
+/*
+ * steal.h - Work-stealing task scheduler
+ *
+ * Each worker thread owns a Chase-Lev deque: it pushes and takes tasks
+ * at the bottom, and idle workers steal from the top of the others'.
+ * Tasks are opaque pointers; running one may push more (to the running
+ * worker's own deque).  sched_run() returns once every task pushed,
+ * including those pushed while running, has finished.  A worker that
+ * finds nothing to take or steal spins briefly, then sleeps until a
+ * task is pushed or the last one finishes.
+ */
+
+#ifndef STEAL_H
+#define STEAL_H
+
+#include "stats.h"
+
+struct sched;
+
+typedef void sched_fn(struct sched *s, int worker, void *task, void *ctx);
+
+/* A scheduler for nworkers threads (exits on out-of-memory) */
+struct sched *sched_new(int nworkers);
+
+/* Queue a task on worker's deque: before sched_run(), or from a task
+   running on that worker.  The last task pushed is the first taken. */
+void sched_push(struct sched *s, int worker, void *task);
+
+/* Run fn on every task with nworkers threads (the caller is worker 0)
+   and wait for all of them.  A worker whose thread cannot be started
+   just has its tasks stolen by the others. */
+void sched_run(struct sched *s, sched_fn *fn, void *ctx);
+
+/* Tasks, steals and busy time of each worker in the last run */
+const struct worker_stats *sched_stats(const struct sched *s);
+
+void sched_free(struct sched *s);
+
+#endif /* STEAL_H */
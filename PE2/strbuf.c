@@ -0,0 +1,191 @@
+/*
+ * strbuf.c - Growable byte buffer (see strbuf.h)
+ */
+
+#include "strbuf.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+void out_of_memory(void) {
+    fprintf(stderr, "Out of memory\n");
+    exit(1);
+}
+
+/* A NULL for zero bytes is not a failure */
+void *xmalloc(size_t size) {
+    void *p = malloc(size);
+    if (!p && size)
+        out_of_memory();
+    return p;
+}
+
+void *xcalloc(size_t n, size_t size) {
+    void *p = calloc(n, size);
+    if (!p && n && size)
+        out_of_memory();
+    return p;
+}
+
+void *xrealloc(void *ptr, size_t size) {
+    void *p = realloc(ptr, size);
+    if (!p && size)
+        out_of_memory();
+    return p;
+}
+
+char *xstrdup(const char *s) {
+    char *t = strdup(s);
+    if (!t)
+        out_of_memory();
+    return t;
+}
+
+void strbuf_reserve(struct strbuf *sb, size_t extra) {
+    if (sb->cap - sb->len >= extra && sb->data)
+        return;
+    size_t cap = sb->cap ? sb->cap : 256;
+    while (cap - sb->len < extra)
+        cap *= 2;
+    sb->data = xrealloc(sb->data, cap);
+    sb->cap  = cap;
+}
+
+void strbuf_add(struct strbuf *sb, const void *data, size_t len) {
+    strbuf_reserve(sb, len);
+    memcpy(sb->data + sb->len, data, len);
+    sb->len += len;
+}
+
+void strbuf_vaddf(struct strbuf *sb, const char *fmt, va_list ap) {
+    va_list copy;
+    int n;
+
+    strbuf_reserve(sb, 128);
+    va_copy(copy, ap);
+    n = vsnprintf(sb->data + sb->len, sb->cap - sb->len, fmt, copy);
+    va_end(copy);
+    if (n < 0)
+        return;
+    if ((size_t) n >= sb->cap - sb->len) {
+        strbuf_reserve(sb, (size_t) n + 1);
+        vsnprintf(sb->data + sb->len, sb->cap - sb->len, fmt, ap);
+    }
+    sb->len += (size_t) n;
+}
+
+void strbuf_addf(struct strbuf *sb, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    strbuf_vaddf(sb, fmt, ap);
+    va_end(ap);
+}
+
+int strbuf_read_fd(struct strbuf *sb, int fd) {
+    for (;;) {
+        strbuf_reserve(sb, 64 * 1024);
+        ssize_t n = read(fd, sb->data + sb->len, sb->cap - sb->len);
+        if (n == 0)
+            return 0;
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        sb->len += (size_t) n;
+    }
+}
+
+int strbuf_write_fd(const struct strbuf *sb, int fd) {
+    const char *p = sb->data;
+    size_t len = sb->len;
+
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        p   += n;
+        len -= (size_t) n;
+    }
+    return 0;
+}
+
+/* The length of the well-formed UTF-8 sequence at s[0..n), which
+   starts with a byte of 0x80 or more, or 0 if it is not one: no
+   overlong forms, surrogates or code points past U+10FFFF */
+static size_t utf8_len(const unsigned char *s, size_t n) {
+    size_t len;
+    unsigned lo = 0x80, hi = 0xbf;      /* the second byte's range */
+
+    if (s[0] >= 0xc2 && s[0] <= 0xdf)
+        len = 2;
+    else if (s[0] >= 0xe0 && s[0] <= 0xef)
+        len = 3;
+    else if (s[0] >= 0xf0 && s[0] <= 0xf4)
+        len = 4;
+    else
+        return 0;
+    if (s[0] == 0xe0)
+        lo = 0xa0;
+    else if (s[0] == 0xed)
+        hi = 0x9f;
+    else if (s[0] == 0xf0)
+        lo = 0x90;
+    else if (s[0] == 0xf4)
+        hi = 0x8f;
+    if (n < len || s[1] < lo || s[1] > hi)
+        return 0;
+    for (size_t i = 2; i < len; i++)
+        if (s[i] < 0x80 || s[i] > 0xbf)
+            return 0;
+    return len;
+}
+
+void strbuf_add_json(struct strbuf *sb, const char *s, size_t n) {
+    static const char hex[] = "0123456789abcdef";
+    size_t run = 0;
+
+    strbuf_reserve(sb, n + 2);
+    sb->data[sb->len++] = '"';
+    for (size_t i = 0; i < n; i++) {
+        unsigned char c = (unsigned char) s[i];
+        size_t k;
+
+        if (c >= 0x20 && c < 0x80 && c != '"' && c != '\\')
+            continue;
+        if (c >= 0x80 && (k = utf8_len((const unsigned char *) s + i,
+                                       n - i)) != 0) {
+            i += k - 1;
+            continue;
+        }
+        /* copy the plain run before c in one go, then escape c */
+        strbuf_add(sb, s + run, i - run);
+        run = i + 1;
+        if (c >= 0x80) {
+            /* not UTF-8, which JSON must be */
+            strbuf_add(sb, "\\ufffd", 6);
+        } else if (c == '"' || c == '\\') {
+            char esc[2] = { '\\', (char) c };
+            strbuf_add(sb, esc, 2);
+        } else if (c == '\n') {
+            strbuf_add(sb, "\\n", 2);
+        } else {
+            char esc[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 15] };
+            strbuf_add(sb, esc, 6);
+        }
+    }
+    strbuf_add(sb, s + run, n - run);
+    strbuf_add(sb, "\"", 1);
+}
+
+void strbuf_free(struct strbuf *sb) {
+    free(sb->data);
+    sb->data = NULL;
+    sb->len  = sb->cap = 0;
+}
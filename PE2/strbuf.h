@@ -0,0 +1,57 @@
+/*
+ * strbuf.h - Growable byte buffer
+ *
+ * Used for collected diagnostics, padded copies of parser input and
+ * protocol replies.  The allocators that exit on out-of-memory, which
+ * every module uses, live here too.  Buffers only ever grow, so one that is reused
+ * across requests stops allocating once it has seen its largest input.
+ */
+
+#ifndef STRBUF_H
+#define STRBUF_H
+
+#include <stdarg.h>
+#include <stddef.h>
+
+/* Print "Out of memory" and exit(1), for callers that cannot go on */
+__attribute__((noreturn)) void out_of_memory(void);
+
+/* malloc(), calloc(), realloc() and strdup() that exit on out-of-memory
+   instead of returning NULL */
+void *xmalloc(size_t size);
+void *xcalloc(size_t n, size_t size);
+void *xrealloc(void *ptr, size_t size);
+char *xstrdup(const char *s);
+
+struct strbuf {
+    char   *data;
+    size_t  len;
+    size_t  cap;
+};
+
+/* Make room for extra more bytes (exits on out-of-memory) */
+void strbuf_reserve(struct strbuf *sb, size_t extra);
+
+void strbuf_add(struct strbuf *sb, const void *data, size_t len);
+void strbuf_addf(struct strbuf *sb, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+void strbuf_vaddf(struct strbuf *sb, const char *fmt, va_list ap);
+
+/* Append everything readable from fd until end of file (-1 on error) */
+int strbuf_read_fd(struct strbuf *sb, int fd);
+
+/* Write all of it to fd (-1 on error) */
+int strbuf_write_fd(const struct strbuf *sb, int fd);
+
+/* Append s[0..n) as a JSON string literal, quotes included; a byte
+   that is not part of well-formed UTF-8 becomes \ufffd */
+void strbuf_add_json(struct strbuf *sb, const char *s, size_t n);
+
+/* Empty the buffer but keep its memory */
+static inline void strbuf_reset(struct strbuf *sb) {
+    sb->len = 0;
+}
+
+void strbuf_free(struct strbuf *sb);
+
+#endif /* STRBUF_H */
@@ -0,0 +1,75 @@
+/*
+ * gen.h - What the checks in tests/ share: random numbers, random
+ * program text and a parse that keeps its diagnostics
+ *
+ * Header-only: each check is one .c file built with the parser's
+ * sources (see the Makefile), and uses only what it needs.
+ */
+
+#ifndef TESTS_GEN_H
+#define TESTS_GEN_H
+
+#include <stddef.h>
+#include <string.h>
+
+#include "../parser.h"
+#include "../strbuf.h"
+
+#define COUNT(a) (unsigned) (sizeof (a) / sizeof (a)[0])
+
+/* A linear congruential generator, the same sequence on every run */
+static unsigned long gen_state = 1;
+
+/* A random number below n */
+static inline unsigned gen_next(unsigned n) {
+    gen_state = gen_state * 6364136223846793005UL + 1442695040888963407UL;
+    return (unsigned) (gen_state >> 33) % n;
+}
+
+/* A statement, with its newline, valid in both dialects */
+static inline const char *gen_stmt(void) {
+    static const char *stmts[] = {
+        "x = 1;\n", "int a, b;\n", "if (a < b) { a = 0; }\n",
+        "if (a) x = 2; else b = 2;\n", "do { a = a - 1; } while (a);\n",
+        "/* { */ y = -a * (b + 2.5);\n", "// }\n{ z = 3; }\n",
+    };
+    return stmts[gen_next(COUNT(stmts))];
+}
+
+/* A few bytes to drop in anywhere, often making the program invalid
+   (or the empty string) */
+static inline const char *gen_piece(void) {
+    static const char *pieces[] = {
+        "{ ", "} ", "/* ", "*/", "// c\n", ";", "(", ")", "a", " + 2",
+        "\n", "else ", "@", "99999999999999999999", "",
+    };
+    return pieces[gen_next(COUNT(pieces))];
+}
+
+/*
+ * Parse src[0..len) from a copy in buf, padded as flex needs it, and
+ * put the diagnostics into out: the parse's result.  p->diag_out must
+ * be NULL, so that the diagnostics are collected.
+ */
+static inline int gen_parse(struct parser *p, const char *src, size_t len,
+                            struct strbuf *buf, struct strbuf *out) {
+    int result;
+
+    strbuf_reset(buf);
+    strbuf_reserve(buf, len + 2);
+    memcpy(buf->data, src, len);
+    buf->data[len] = buf->data[len + 1] = '\0';
+    buf->len = len;
+    result = parser_parse_buffer(p, buf->data, len);
+    strbuf_reset(out);
+    strbuf_add(out, p->diag.data, p->diag.len);
+    return result;
+}
+
+/* 1 if a and b hold the same bytes */
+static inline int gen_same(const struct strbuf *a, const struct strbuf *b) {
+    return a->len == b->len &&
+           (a->len == 0 || memcmp(a->data, b->data, a->len) == 0);
+}
+
+#endif /* TESTS_GEN_H */
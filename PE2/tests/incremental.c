@@ -0,0 +1,157 @@
+/*
+ * incremental.c - An edited document must read as if parsed afresh
+ *
+ *     ./tests/incremental [ROUNDS]
+ *
+ * Each round builds a document of a few dozen statements and edits it
+ * EDITS times: a statement typed in or deleted at a statement boundary,
+ * several of those at once through document_apply(), or a few bytes
+ * replaced anywhere, which the next edit undoes.  After every update it
+ * is compared with a document parsed from scratch out of the same text:
+ *
+ *   valid      the same statements, segment for segment
+ *   not valid  the same first diagnostic, at the same line, and the
+ *              same statements before it
+ *
+ * Past the first error the two may cut the text differently (an error
+ * segment ends at a boundary the edited document remembers), so they
+ * are not compared there.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../document.h"
+#include "gen.h"
+
+#define STMTS  40
+#define EDITS  50
+
+static void generate(struct strbuf *src) {
+    static const char *first[] = {
+        "int a%d, b%d;\n",
+        "a%d = b%d * 2 + 1; /* { */\n",
+        "if (a%d > b%d) { a%d = a%d - 1; } else b%d = 0;\n",
+        "do { b%d = b%d + 1; } while (b%d < 10); // }\n",
+    };
+
+    strbuf_reset(src);
+    for (int i = 0; i < STMTS; i++)
+        strbuf_addf(src, first[gen_next(4)], i, i, i, i, i);
+}
+
+/* A statement typed in at, or segment i deleted */
+static struct doc_edit statement_edit(const struct document *d, int i) {
+    struct segment s = document_segment(d, i);
+    const char *t = gen_stmt();
+
+    if (gen_next(3) == 0)
+        return (struct doc_edit) { s.start, s.end, "", 0 };
+    return (struct doc_edit) { s.start, s.start, t, strlen(t) };
+}
+
+static int same_seg(struct segment a, struct segment b) {
+    return a.start == b.start && a.end == b.end && a.line == b.line;
+}
+
+/* inc against full, the same text parsed from scratch: 0 if they agree */
+static int compare(struct document *inc, struct document *full) {
+    size_t until = full->nerrs ? full->errs[0].start : full->len;
+
+    if ((inc->nerrs == 0) != (full->nerrs == 0))
+        return -1;
+    if (full->nerrs && (inc->errs[0].err_line != full->errs[0].err_line ||
+                        strcmp(inc->errs[0].diag, full->errs[0].diag) != 0))
+        return -1;
+    if (!full->nerrs && inc->nsegs != full->nsegs)
+        return -1;
+    for (int i = 0; i < full->nsegs && i < inc->nsegs; i++) {
+        struct segment f = document_segment(full, i);
+        if (f.end > until)
+            break;
+        if (!same_seg(document_segment(inc, i), f))
+            return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 200;
+    struct parser *p = parser_new();
+    struct strbuf src = { 0 }, text = { 0 }, removed = { 0 };
+    struct doc_edit undo = { 0 };
+    long updates = 0, invalid = 0;
+    int failed = 0;
+
+    for (int r = 0; r < rounds && !failed; r++) {
+        struct document d = { 0 };
+
+        parser_set_dialect(p, r % 2 ? DIALECT_A1 : DIALECT_PE2);
+        generate(&src);
+        document_set(&d, p, src.data, src.len);
+        for (int e = 0; e < EDITS && !failed; e++) {
+            struct doc_edit edits[4];
+            int n = 1;
+
+            if (undo.text) {
+                edits[0] = undo;
+                undo.text = NULL;
+            } else if (d.nsegs == 0 || gen_next(4) == 0) {
+                /* a few bytes anywhere, kept to be put back */
+                const char *t = gen_piece();
+                size_t start = gen_next((unsigned) d.len + 1);
+                size_t end = start + gen_next(4);
+
+                if (end > d.len)
+                    end = d.len;
+                strbuf_reset(&removed);
+                for (size_t i = start; i < end; i++)
+                    strbuf_add(&removed, &(char) { document_byte(&d, i) },
+                               1);
+                edits[0] = (struct doc_edit) { start, end, t, strlen(t) };
+                undo = (struct doc_edit) { start, start + strlen(t),
+                                           removed.data ? removed.data : "",
+                                           removed.len };
+            } else {
+                /* statements, in order, at most one per segment */
+                int at = 0;
+                int want = gen_next(3) == 0 ? 2 + (int) gen_next(3) : 1;
+
+                for (n = 0; n < want && at < d.nsegs; n++) {
+                    at += (int) gen_next((unsigned) (d.nsegs - at));
+                    edits[n] = statement_edit(&d, at++);
+                }
+            }
+            if (n == 1)
+                document_edit(&d, p, edits[0].start, edits[0].end,
+                              edits[0].text, edits[0].len);
+            else
+                document_apply(&d, p, edits, n);
+
+            struct document full = { 0 };
+            strbuf_reset(&text);
+            strbuf_add(&text, document_text(&d), d.len);
+            document_set(&full, p, text.data, text.len);
+            updates++;
+            invalid += full.nerrs != 0;
+            if (compare(&d, &full) != 0) {
+                printf("incremental: round %d, edit %d differs:\n%.*s\n"
+                       "  edited: %s  fresh:  %s", r, e,
+                       (int) text.len, text.data,
+                       d.nerrs ? d.errs[0].diag : "valid\n",
+                       full.nerrs ? full.errs[0].diag : "valid\n");
+                failed = 1;
+            }
+            document_free(&full);
+        }
+        document_free(&d);
+    }
+    printf("incremental: %ld updates (%ld not valid), %s\n", updates,
+           invalid, failed ? "FAILED" : "all as a fresh parse");
+    strbuf_free(&src);
+    strbuf_free(&text);
+    strbuf_free(&removed);
+    parser_free(p);
+    return failed;
+}
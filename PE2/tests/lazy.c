@@ -0,0 +1,63 @@
+/*
+ * lazy.c - lazy_blocks must not change a verdict or a diagnostic
+ *
+ *     ./tests/lazy
+ *
+ * Parses each case with and without lazy_blocks, in both dialects, and
+ * checks that the two parses agree on the verdict and on every
+ * diagnostic.  A block whose body the scanner cannot skip (an unclosed
+ * comment in it) must be scanned as a full parse scans it.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "gen.h"
+
+static const struct {
+    const char *src;
+    int         valid;
+} cases[] = {
+    { "int x;\nif (x) {\n  x = 1; /* never closed\n  y = 2;\n}\n", 0 },
+    { "do { /* { */ x = 1; /* never closed } while (x);\n", 0 },
+    { "if (x) { { x = 1; } /* } ", 0 },
+    { "if (x) { x = 1; // }\n}\n/* closed */ y = 2;\n", 1 },
+    { "if (x) { x = 1; /* } { */ }\ny = 2; /* not closed", 0 },
+    { "if (x) { /**/ x = 1; /*/ } */ }\n", 1 },
+};
+
+int main(void) {
+    struct parser *p = parser_new();
+    struct strbuf buf = { 0 }, full = { 0 }, lazy = { 0 };
+    int failed = 0, n = 0;
+
+    p->diag_out = NULL;
+    for (int d = DIALECT_PE2; d <= DIALECT_A1; d++) {
+        parser_set_dialect(p, (enum dialect) d);
+        for (size_t i = 0; i < sizeof cases / sizeof cases[0]; i++) {
+            const char *src = cases[i].src;
+
+            p->lazy_blocks = 0;
+            int r_full = gen_parse(p, src, strlen(src), &buf, &full);
+            p->lazy_blocks = 1;
+            int r_lazy = gen_parse(p, src, strlen(src), &buf, &lazy);
+
+            n++;
+            if (r_full != r_lazy || (r_full == 0) != cases[i].valid ||
+                !gen_same(&full, &lazy)) {
+                printf("lazy: case %zu (%s): full %d, lazy %d\n"
+                       "  full: %.*s  lazy: %.*s\n", i,
+                       d == DIALECT_A1 ? "a1" : "pe2", r_full, r_lazy,
+                       (int) full.len, full.data, (int) lazy.len,
+                       lazy.data);
+                failed++;
+            }
+        }
+    }
+    printf("lazy: %d cases, %d failed\n", n, failed);
+    strbuf_free(&buf);
+    strbuf_free(&full);
+    strbuf_free(&lazy);
+    parser_free(p);
+    return failed != 0;
+}
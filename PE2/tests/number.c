@@ -0,0 +1,166 @@
+/*
+ * number.c - Literal conversion must round as strtod() does
+ *
+ *     ./tests/number [N]
+ *
+ * Converts literals with number_float() and number_int() and compares
+ * the result with strtod() and strtoull(), bit for bit.  Most of the
+ * float cases sit on a rounding boundary or within one digit of it:
+ * the exact midpoint between two adjacent doubles, and the same with
+ * its last digit one lower or higher.  Those are made for doubles with
+ * 0 to 4 fraction bits, whose midpoints have 16 to 20 significant
+ * digits, on either side of the fast paths' limit of 19, and for
+ * doubles near 1, whose midpoints go to strtod().  The rest are random
+ * literals of 1 to 25 digits and the boundaries of the integer and
+ * overflow checks.
+ */
+
+#include <errno.h>
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../number.h"
+
+static unsigned long long rnd = 1;
+
+static uint64_t next64(void) {
+    rnd ^= rnd << 13;
+    rnd ^= rnd >> 7;
+    rnd ^= rnd << 17;
+    return rnd;
+}
+
+static long checked, failed;
+
+/* One float literal, digits '.' digits */
+static void check_float(const char *s) {
+    struct number n = number_float(s, strlen(s));
+    double want = strtod(s, NULL);
+
+    checked++;
+    if (n.kind != NUMBER_FLOAT || n.overflow != (want > DBL_MAX) ||
+        (!n.overflow && memcmp(&n.f, &want, sizeof want) != 0)) {
+        if (failed++ < 10)
+            printf("number: %s: got %.17g%s, want %.17g\n", s, n.f,
+                   n.overflow ? " (overflow)" : "", want);
+    }
+}
+
+/* One integer literal, digits */
+static void check_int(const char *s) {
+    struct number n = number_int(s, strlen(s));
+    unsigned long long want;
+    int over;
+
+    errno = 0;
+    want = strtoull(s, NULL, 10);
+    over = errno == ERANGE || want > INT64_MAX;
+    checked++;
+    if (n.kind != NUMBER_INT || n.overflow != over ||
+        (!over && (unsigned long long) n.i != want)) {
+        if (failed++ < 10)
+            printf("number: %s: got %lld%s\n", s, (long long) n.i,
+                   n.overflow ? " (overflow)" : "");
+    }
+}
+
+/* s, a decimal with its last digit changed by delta (-1 or +1) */
+static void check_nudged(const char *s, int delta) {
+    char t[512];
+    size_t len = strlen(s);
+
+    memcpy(t, s, len + 1);
+    if ((t[len - 1] == '0' && delta < 0) || (t[len - 1] == '9' && delta > 0))
+        return;
+    t[len - 1] = (char) (t[len - 1] + delta);
+    check_float(t);
+}
+
+/* The midpoint above x, exactly, with frac digits after the point (a
+   long double holds it: it needs one bit more than x) */
+static void check_midpoint(double x, int frac) {
+    char s[512];
+    long double mid = (long double) x +
+                      ((long double) nextafter(x, INFINITY) - x) / 2;
+
+    snprintf(s, sizeof s, "%.*Lf", frac, mid);
+    check_float(s);
+    check_nudged(s, -1);
+    check_nudged(s, +1);
+
+    /* a digit past the midpoint: the slow path, and just above it */
+    strcat(s, "1");
+    check_float(s);
+}
+
+int main(int argc, char **argv) {
+    long n = argc > 1 ? atol(argv[1]) : 200000;
+    char s[512];
+
+    /* doubles with j fraction bits: midpoints with j + 1 decimals */
+    for (long i = 0; i < n; i++) {
+        int j = (int) (i % 5);
+        double x = ldexp((double) ((1ULL << 52) | (next64() >> 12)),
+                         1 - j);
+        check_midpoint(x, j + 1);
+    }
+
+    /* near 1: midpoints of 53 decimals */
+    if (LDBL_MANT_DIG >= 64)
+        for (long i = 0; i < n / 10; i++)
+            check_midpoint(1 + ldexp((double) (next64() >> 12), -52), 53);
+
+    /* random literals, 1 to 25 digits, the point anywhere */
+    for (long i = 0; i < n; i++) {
+        int digits = 1 + (int) (next64() % 25);
+        int point = 1 + (int) (next64() % (uint64_t) digits);
+        char *p = s;
+
+        for (int d = 0; d < digits; d++) {
+            if (d == point)
+                *p++ = '.';
+            *p++ = (char) ('0' + next64() % 10);
+        }
+        if (point == digits) {
+            *p++ = '.';
+            *p++ = (char) ('0' + next64() % 10);
+        }
+        *p = '\0';
+        check_float(s);
+    }
+
+    /* the largest double, and the midpoint past it, from which on a
+       literal overflows (DBL_MAX is odd: the tie rounds up) */
+    snprintf(s, sizeof s, "%.1f", DBL_MAX);
+    check_float(s);
+    snprintf(s, sizeof s, "%.0Lf", (long double) DBL_MAX + ldexpl(1, 970));
+    strcat(s, ".0");
+    check_float(s);
+    s[strlen(s) - 1] = '1';
+    check_float(s);
+    s[strlen(s) - 3]--;
+    s[strlen(s) - 1] = '9';
+    check_float(s);
+
+    /* integers: around INT64_MAX, leading zeros, one to 20 digits */
+    check_int("9223372036854775807");
+    check_int("9223372036854775808");
+    check_int("09223372036854775807");
+    check_int("18446744073709551616");
+    check_int("000000000000000000000000001");
+    check_int("0");
+    for (long i = 0; i < n; i++) {
+        int digits = 1 + (int) (next64() % 20);
+        for (int d = 0; d < digits; d++)
+            s[d] = (char) ('0' + next64() % 10);
+        s[digits] = '\0';
+        check_int(s);
+    }
+
+    printf("number: %ld literals, %ld wrong\n", checked, failed);
+    return failed != 0;
+}
@@ -0,0 +1,89 @@
+/*
+ * pipe.c - A program scanned on a thread of its own must get the verdict
+ * of a plain parse
+ *
+ *     ./tests/pipe [N]
+ *
+ * Parses N random programs, in both dialects, as parser_parse_buffer()
+ * does by default and with lex_pipe set to 1, so that every one is
+ * scanned on a second thread while it is parsed.  Each time, it picks a
+ * batch of 1 to 64 tokens or the default.  It checks that the two parses
+ * agree on the verdict and on every diagnostic.  Most programs are a
+ * few hundred bytes long.  One in eight is 64 to 320 KB, so that the
+ * scanner reads it in several pieces (YY_INPUT, lexer.l) and long
+ * comments cross from one piece into the next.  Half of the programs
+ * have a few bytes dropped in at random, anywhere in the text.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gen.h"
+
+static void generate(struct strbuf *src) {
+    size_t want = gen_next(8) == 0 ? (64 + gen_next(256)) * 1024
+                                   : gen_next(600);
+
+    strbuf_reset(src);
+    while (src->len < want) {
+        if (gen_next(50) == 0) {
+            /* a comment of up to 80 KB */
+            size_t end = src->len + gen_next(80 * 1024);
+            strbuf_add(src, "/*", 2);
+            while (src->len < end)
+                strbuf_add(src, gen_next(60) ? "-" : "\n", 1);
+            strbuf_add(src, "*/\n", 3);
+        } else {
+            const char *s = gen_stmt();
+            strbuf_add(src, s, strlen(s));
+        }
+    }
+    for (unsigned n = gen_next(2) ? 1 + gen_next(3) : 0; n > 0; n--) {
+        const char *t = gen_piece();
+        size_t at = gen_next((unsigned) src->len + 1), len = strlen(t);
+
+        strbuf_reserve(src, len);
+        memmove(src->data + at + len, src->data + at, src->len - at);
+        memcpy(src->data + at, t, len);
+        src->len += len;
+    }
+}
+
+int main(int argc, char **argv) {
+    long n = argc > 1 ? atol(argv[1]) : 2000, invalid = 0, failed = 0;
+    struct parser *p = parser_new();
+    struct strbuf src = { 0 }, buf = { 0 }, plain = { 0 }, piped = { 0 };
+
+    p->diag_out = NULL;
+    for (long i = 0; i < n; i++) {
+        parser_set_dialect(p, i % 2 ? DIALECT_A1 : DIALECT_PE2);
+        generate(&src);
+
+        p->lex_pipe = 0;
+        p->token_batch = 0;
+        int r_plain = gen_parse(p, src.data, src.len, &buf, &plain);
+
+        p->lex_pipe = 1;
+        p->token_batch = gen_next(4) ? 1 + (int) gen_next(64) : 0;
+        int r_piped = gen_parse(p, src.data, src.len, &buf, &piped);
+
+        invalid += r_plain != 0;
+        if (r_plain != r_piped || !gen_same(&plain, &piped)) {
+            if (failed++ < 3)
+                printf("pipe: program %ld (%zu bytes, batch %d): plain %d, "
+                       "piped %d\n  plain: %.*s  piped: %.*s\n", i,
+                       src.len, p->token_batch, r_plain, r_piped,
+                       (int) plain.len, plain.data, (int) piped.len,
+                       piped.data);
+        }
+    }
+    printf("pipe: %ld programs (%ld not valid), %ld differ\n", n, invalid,
+           failed);
+    strbuf_free(&src);
+    strbuf_free(&buf);
+    strbuf_free(&plain);
+    strbuf_free(&piped);
+    parser_free(p);
+    return failed != 0;
+}
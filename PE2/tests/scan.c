@@ -0,0 +1,97 @@
+/*
+ * scan.c - A scan on several threads must give a single thread's tokens
+ *
+ *     ./tests/scan [N]
+ *
+ * Built with a TOKENS_CHUNK_MIN of 16 bytes (see the Makefile), so that
+ * tokens_scan() cuts even a short buffer into as many chunks as it has
+ * threads.  Scans N random buffers, in both dialects, on one thread and
+ * on 2 to 32, and checks that the two lists have the same tokens: kind,
+ * offset, length and, for a NUM, value.  The buffers are made of tokens,
+ * comment delimiters, stray stars and slashes and long comments spanning
+ * several lines, so that chunks start inside comments, just past a
+ * star-slash, inside a // comment's line and in a comment that is never
+ * closed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../grammar.h"
+#include "../tokens.h"
+#include "gen.h"
+
+static const char *pieces[] = {
+    "/*", "*/", "*", "/", "//", "\n", "\n", " ", "a", "b1", "12", "3.5",
+    ".", "{", "}", ";", "=", "if", "@", "/**/", "**/", "/*/",
+    "99999999999999999999", "1e999", "\0",
+};
+
+/* Up to 600 bytes of pieces into buf, and the two NULs: its length */
+static size_t generate(char *buf) {
+    size_t len = 0, want = gen_next(600);
+
+    while (len < want) {
+        if (gen_next(40) == 0) {
+            /* a comment over several lines, closed or not */
+            size_t end = len + 20 + gen_next(120);
+            memcpy(buf + len, "/*", 2);
+            for (len += 2; len < end; len++)
+                buf[len] = gen_next(8) == 0 ? '\n' : "a *;/"[gen_next(5)];
+            if (gen_next(4) != 0) {
+                memcpy(buf + len, "*/", 2);
+                len += 2;
+            }
+            continue;
+        }
+        unsigned k = gen_next(COUNT(pieces));
+        size_t n = pieces[k][0] ? strlen(pieces[k]) : 1;
+        memcpy(buf + len, pieces[k], n);
+        len += n;
+    }
+    buf[len] = buf[len + 1] = '\0';
+    return len;
+}
+
+/* a against b: 0 if they hold the same tokens */
+static int compare(const struct token_buf *a, const struct token_buf *b) {
+    if (a->tail != b->tail)
+        return -1;
+    for (size_t i = 0; i < a->tail; i++) {
+        if (a->kinds[i] != b->kinds[i] || a->offsets[i] != b->offsets[i] ||
+            a->lengths[i] != b->lengths[i])
+            return -1;
+        if (a->buf[a->offsets[i]] >= '0' && a->buf[a->offsets[i]] <= '9' &&
+            memcmp(&a->values[i], &b->values[i], sizeof *a->values) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    long n = argc > 1 ? atol(argv[1]) : 10000, chunks = 0, failed = 0;
+    struct token_buf one = { 0 }, many = { 0 };
+    static char buf[1024];
+
+    for (long i = 0; i < n; i++) {
+        const struct grammar *g = i % 2 ? &a1_grammar : &pe2_grammar;
+        size_t len = generate(buf);
+        int threads = 2 + (int) gen_next(31);
+
+        tokens_scan(g, buf, len, 1, &one);
+        chunks += tokens_scan(g, buf, len, threads, &many);
+        if (one.kinds[one.tail - 1] != 0 ||
+            one.offsets[one.tail - 1] != len || compare(&one, &many) != 0) {
+            if (failed++ < 3)
+                printf("scan: %zu bytes on %d threads: %zu tokens, "
+                       "not %zu:\n%.*s\n", len, threads, many.tail,
+                       one.tail, (int) len, buf);
+        }
+    }
+    printf("scan: %ld buffers in %ld chunks, %ld differ\n", n, chunks,
+           failed);
+    tokens_free(&one);
+    tokens_free(&many);
+    return failed != 0;
+}
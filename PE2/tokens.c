@@ -0,0 +1,529 @@
+/*
+ * tokens.c - Tokens scanned ahead of the parse (see tokens.h)
+ */
+
+#define _GNU_SOURCE             /* memmem */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "grammar.h"
+#include "strbuf.h"
+#include "tokens.h"
+
+#define NONE SIZE_MAX
+
+/* ================================================================
+   Token buffers
+   ================================================================ */
+
+/* Capacity 2^k >= n, keeping the tokens [0, tail) of a list */
+static void resize(struct token_buf *t, size_t n) {
+    size_t cap = 4096;
+
+    while (cap < n)
+        cap *= 2;
+    if (t->kinds && cap == t->mask + 1)
+        return;
+    t->kinds   = xrealloc(t->kinds, cap * sizeof *t->kinds);
+    t->offsets = xrealloc(t->offsets, cap * sizeof *t->offsets);
+    t->lengths = xrealloc(t->lengths, cap * sizeof *t->lengths);
+    t->values  = xrealloc(t->values, cap * sizeof *t->values);
+    t->mask = cap - 1;
+}
+
+void tokens_ring(struct token_buf *t, size_t batch,
+                 void (*fill)(void *scanner, struct token_buf *t),
+                 void *scanner, const char *buf) {
+    resize(t, batch + 1);
+    t->head = t->tail = 0;
+    t->ended = 0;
+    t->batch = batch;
+    t->fill = fill;
+    t->scanner = scanner;
+    t->buf = buf;
+}
+
+void tokens_reserve(struct token_buf *t, size_t n) {
+    if (!t->kinds || n > tokens_room(t))
+        resize(t, t->tail + n + 1);
+}
+
+/* Append from's tokens [i, i + n) to the list t */
+static void append(struct token_buf *t, const struct token_buf *from,
+                   size_t i, size_t n) {
+    if (n == 0)
+        return;
+    tokens_reserve(t, n);
+    memcpy(t->kinds + t->tail, from->kinds + i, n * sizeof *t->kinds);
+    memcpy(t->offsets + t->tail, from->offsets + i,
+           n * sizeof *t->offsets);
+    memcpy(t->lengths + t->tail, from->lengths + i,
+           n * sizeof *t->lengths);
+    memcpy(t->values + t->tail, from->values + i, n * sizeof *t->values);
+    t->tail += n;
+}
+
+/* Put a token without a value after the last in t, which has room */
+static void put(struct token_buf *t, int kind, size_t offset,
+                size_t length) {
+    size_t i = t->tail++ & t->mask;
+
+    t->kinds[i]   = (uint16_t) kind;
+    t->offsets[i] = offset;
+    t->lengths[i] = length > UINT32_MAX ? UINT32_MAX : (uint32_t) length;
+}
+
+/* Append a token without a value to the list t */
+static void push(struct token_buf *t, int kind, size_t offset,
+                 size_t length) {
+    tokens_reserve(t, 1);
+    put(t, kind, offset, length);
+}
+
+void tokens_free(struct token_buf *t) {
+    free(t->kinds);
+    free(t->offsets);
+    free(t->lengths);
+    free(t->values);
+    strbuf_free(&t->text);
+    memset(t, 0, sizeof *t);
+}
+
+size_t tokens_start(const struct token_buf *t) {
+    return t->head ? t->offsets[(t->head - 1) & t->mask] : 0;
+}
+
+/* A ring's tokens are in the buffer the scanner is in: flex's NUL is
+   only ever after the last one it scanned, past any the parser took */
+const char *tokens_text(struct token_buf *t) {
+    size_t at = 0, n = 0;
+
+    if (t->head) {
+        at = t->offsets[(t->head - 1) & t->mask];
+        n  = t->lengths[(t->head - 1) & t->mask];
+    }
+    strbuf_reset(&t->text);
+    strbuf_reserve(&t->text, n + 1);
+    memcpy(t->text.data, t->buf + at, n);
+    t->text.data[n] = '\0';
+    return t->text.data;
+}
+
+/* ================================================================
+   One chunk, scanned both ways
+   ================================================================ */
+struct chunk {
+    const struct grammar *g;
+    const char   *buf;          /* the whole input                   */
+    size_t        begin, end;   /* this chunk of it, after a newline */
+
+    /* From begin, outside a comment */
+    struct token_buf out;
+    size_t        out_open;     /* the comment it ends in, if        */
+    int           out_in;       /*   out_in                          */
+
+    /* Inside a comment: from close (NONE if the comment does not end
+       in this chunk), then out's tokens from join (NONE: no more) */
+    size_t        close;
+    struct token_buf in;
+    size_t        join;
+    size_t        in_open;
+    int           in_in;
+
+    int           open_kind;    /* the scanner's error token for it  */
+    int           failed;       /* the scanner could not be made     */
+};
+
+/* Where a scan puts its tokens */
+struct scan {
+    const struct token_buf *out;    /* inside: stop on meeting these */
+    size_t        from;             /* ... the first one not compared */
+    size_t        at;               /* ... the next of out's         */
+    size_t        join;
+};
+
+/* After each batch: stop an inside scan where it meets the outside
+   one, or make room for the next batch */
+static int more(void *ctx, struct token_buf *t) {
+    struct scan *s = ctx;
+
+    if (s->out) {
+        for (; s->from < t->tail; s->from++) {
+            size_t begin = t->offsets[s->from];
+
+            while (s->at < s->out->tail && s->out->offsets[s->at] < begin)
+                s->at++;
+            if (s->at < s->out->tail && s->out->offsets[s->at] == begin) {
+                s->join = s->at;
+                t->tail = s->from;
+                return 0;
+            }
+        }
+    }
+    if (tokens_room(t) == 0)
+        tokens_reserve(t, t->mask + 1);
+    return 1;
+}
+
+/* The scanner ends an unclosed comment with an error token that runs
+   to the end: take it off, and report where it starts */
+static int open_comment(struct chunk *c, struct token_buf *to,
+                        size_t *open) {
+    size_t last, begin;
+
+    /* '/' and '*' as operators are two tokens of one byte each */
+    if (to->tail == 0)
+        return 0;
+    last  = to->tail - 1;
+    begin = to->offsets[last];
+    if (begin + to->lengths[last] != c->end || to->lengths[last] < 2 ||
+        memcmp(c->buf + begin, "/*", 2) != 0)
+        return 0;
+    *open = begin;
+    c->open_kind = to->kinds[last];
+    to->tail--;
+    return 1;
+}
+
+static void *scan_chunk(void *arg) {
+    struct chunk *c = arg;
+    struct parser extra = { .grammar = c->g, .stream_fd = -1 };
+    struct strbuf copy = { 0 };
+    void *scanner;
+    size_t len = c->end - c->begin;
+    const char *star;
+
+    if (c->g->scanner_new(&extra, &scanner) != 0) {
+        c->failed = 1;
+        return NULL;
+    }
+
+    /* flex writes into what it scans, and the next chunk is another
+       thread's: scan a copy, with the two NULs flex needs */
+    strbuf_reserve(&copy, len + 2);
+    memcpy(copy.data, c->buf + c->begin, len);
+    copy.data[len] = copy.data[len + 1] = '\0';
+
+    /* about one token in four bytes of code, and the list only grows
+       by doubling (and copying) if there are more */
+    tokens_reserve(&c->out, len / 4);
+    struct scan s = { 0 };
+    if (c->g->scan(scanner, copy.data, len, c->begin, &c->out, more,
+                   &s) != 0)
+        c->failed = 1;
+    c->out_in = open_comment(c, &c->out, &c->out_open);
+
+    /* the comment a chunk may start in ends at the first star-slash */
+    c->close = NONE;
+    c->join  = NONE;
+    star = memmem(copy.data, len, "*/", 2);
+    if (star && c->begin > 0) {
+        size_t from = (size_t) (star - copy.data) + 2;
+
+        c->close = c->begin + from;
+        s = (struct scan) { .out = &c->out, .join = NONE };
+        tokens_reserve(&c->in, 1);
+        if (c->g->scan(scanner, copy.data + from, len - from, c->close,
+                       &c->in, more, &s) != 0)
+            c->failed = 1;
+        c->join = s.join;
+        c->in_in = c->join == NONE && open_comment(c, &c->in, &c->in_open);
+    }
+
+    c->g->scanner_free(scanner);
+    strbuf_free(&copy);
+    return NULL;
+}
+
+/* ================================================================
+   Cutting, scanning and stitching
+   ================================================================ */
+int tokens_scan(const struct grammar *g, const char *buf, size_t len,
+                int nthreads, struct token_buf *t) {
+    int n = nthreads;
+    struct chunk *chunks;
+    pthread_t *threads;
+    char *started;
+
+    if ((size_t) n > len / TOKENS_CHUNK_MIN)
+        n = (int) (len / TOKENS_CHUNK_MIN);
+    if (n < 1)
+        n = 1;
+    chunks  = xcalloc(n, sizeof *chunks);
+    threads = xcalloc(n, sizeof *threads);
+    started = xcalloc(n, 1);
+
+    /* each chunk starts just after a newline (one without any joins
+       the next) */
+    size_t at = 0;
+    int k = 0;
+    for (int i = 1; i <= n; i++) {
+        size_t end = i == n ? len : (size_t) ((double) len * i / n);
+        const char *nl;
+
+        if (end < at)
+            end = at;
+        if (i < n) {
+            nl = memchr(buf + end, '\n', len - end);
+            end = nl ? (size_t) (nl - buf) + 1 : len;
+        }
+        if (end == at && i < n)
+            continue;
+        chunks[k].g = g;
+        chunks[k].buf = buf;
+        chunks[k].begin = at;
+        chunks[k].end = end;
+        k++;
+        at = end;
+        if (at == len)
+            break;
+    }
+    n = k;
+
+    /* the caller scans chunk 0, and any whose thread did not start */
+    for (int i = 1; i < n; i++)
+        started[i] = pthread_create(&threads[i], NULL, scan_chunk,
+                                    &chunks[i]) == 0;
+    scan_chunk(&chunks[0]);
+    for (int i = 1; i < n; i++) {
+        if (started[i])
+            pthread_join(threads[i], NULL);
+        else
+            scan_chunk(&chunks[i]);
+    }
+
+    /* Stitch: each chunk as the one before it ended */
+    size_t open = 0;
+    int in = 0, open_kind = 0;
+
+    size_t total = 1;
+    for (int i = 0; i < n; i++)
+        total += chunks[i].out.tail + chunks[i].in.tail + 1;
+    t->head = t->tail = 0;
+    tokens_reserve(t, total);
+    t->ended = 1;
+    t->fill = NULL;
+    t->buf = buf;
+    for (int i = 0; i < n; i++) {
+        struct chunk *c = &chunks[i];
+
+        if (c->failed)
+            out_of_memory();
+        if (!in) {
+            append(t, &c->out, 0, c->out.tail);
+            if ((in = c->out_in))
+                open = c->out_open;
+        } else if (c->close != NONE) {
+            append(t, &c->in, 0, c->in.tail);
+            if (c->join != NONE) {
+                append(t, &c->out, c->join, c->out.tail - c->join);
+                if ((in = c->out_in))
+                    open = c->out_open;
+            } else if ((in = c->in_in)) {
+                open = c->in_open;
+            }
+        }
+        /* else the whole chunk is in the comment */
+        if (c->open_kind)
+            open_kind = c->open_kind;
+    }
+
+    /* the scanner's error token for a comment that never ends */
+    if (in)
+        push(t, open_kind, open, len - open);
+    push(t, 0, len, 0);
+
+    for (int i = 0; i < n; i++) {
+        tokens_free(&chunks[i].out);
+        tokens_free(&chunks[i].in);
+    }
+    free(chunks);
+    free(threads);
+    free(started);
+    return n;
+}
+
+/* ================================================================
+   A scanner thread, feeding the parser a batch at a time
+   ================================================================ */
+
+/* Batches the ring holds: the scanner may run this far ahead */
+#define PIPE_BATCHES 8
+
+/* Times a side looks for the other's progress before it sleeps */
+#define PIPE_SPINS   64
+
+struct token_pipe {
+    _Alignas(64) atomic_size_t tail;    /* scanned: the parser may take
+                                           up to here                */
+    _Alignas(64) atomic_size_t head;    /* taken: the scanner may reuse
+                                           the slots before head - 1 */
+    atomic_int    ended;        /* tail is final, the end token last */
+    atomic_int    stop;         /* the parse is over                 */
+
+    /* A side that has spun PIPE_SPINS times counts itself in sleeping,
+       looks once more, and waits on moved; the other looks at sleeping
+       after each update, with a full fence on both sides, so one of
+       the two always sees the other */
+    atomic_int    sleeping;
+    pthread_mutex_t lock;
+    pthread_cond_t  moved;
+
+    const struct grammar *g;
+    const char   *buf;
+    size_t        len;
+    struct token_buf out;       /* the scanner's view of the ring    */
+    int           failed;
+    pthread_t     thread;
+};
+
+/* Sleep while *at still reads seen and *flag is not set */
+static void pipe_sleep(struct token_pipe *pipe, atomic_size_t *at,
+                       size_t seen, atomic_int *flag) {
+    pthread_mutex_lock(&pipe->lock);
+    atomic_fetch_add_explicit(&pipe->sleeping, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(at, memory_order_relaxed) == seen &&
+        !atomic_load_explicit(flag, memory_order_relaxed))
+        pthread_cond_wait(&pipe->moved, &pipe->lock);
+    atomic_fetch_sub_explicit(&pipe->sleeping, 1, memory_order_relaxed);
+    pthread_mutex_unlock(&pipe->lock);
+}
+
+/* After moving tail, head, ended or stop: wake the other side */
+static void pipe_wake(struct token_pipe *pipe) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&pipe->sleeping, memory_order_relaxed) == 0)
+        return;
+    pthread_mutex_lock(&pipe->lock);
+    pthread_cond_broadcast(&pipe->moved);
+    pthread_mutex_unlock(&pipe->lock);
+}
+
+/* The scanner, after each batch: publish it, then wait for room */
+static int publish(void *ctx, struct token_buf *out) {
+    struct token_pipe *pipe = ctx;
+
+    atomic_store_explicit(&pipe->tail, out->tail, memory_order_release);
+    pipe_wake(pipe);
+    for (int spins = 0;; spins++) {
+        if (atomic_load_explicit(&pipe->stop, memory_order_relaxed))
+            return 0;
+        out->head = atomic_load_explicit(&pipe->head, memory_order_acquire);
+        if (tokens_room(out) > 0)
+            return 1;
+        if (spins < PIPE_SPINS)
+            sched_yield();
+        else
+            pipe_sleep(pipe, &pipe->head, out->head, &pipe->stop);
+    }
+}
+
+static void *produce(void *arg) {
+    struct token_pipe *pipe = arg;
+    struct parser extra = { .grammar = pipe->g, .stream_fd = -1,
+                            .stream_src = pipe->buf,
+                            .stream_len = pipe->len };
+    void *scanner;
+
+    /* flex writes NULs into what it scans, and the parser reads the
+       buffer meanwhile: flex copies it into a buffer of its own, a
+       piece at a time, as it would read a file */
+    pipe->failed = pipe->g->scanner_new(&extra, &scanner) != 0;
+    if (!pipe->failed) {
+        pipe->failed = pipe->g->scan(scanner, NULL, pipe->len, 0,
+                                     &pipe->out, publish, pipe) != 0;
+        pipe->g->scanner_free(scanner);
+    }
+
+    /* the end token, where the scanner puts it (scan() leaves it out) */
+    if (pipe->failed || publish(pipe, &pipe->out)) {
+        put(&pipe->out, 0, pipe->failed ? 0 : pipe->len, 0);
+        atomic_store_explicit(&pipe->tail, pipe->out.tail,
+                              memory_order_release);
+    }
+    atomic_store_explicit(&pipe->ended, 1, memory_order_release);
+    pipe_wake(pipe);
+    return NULL;
+}
+
+/* The parser, with every token taken: say so, then wait for a batch */
+static void take_batch(void *ctx, struct token_buf *t) {
+    struct token_pipe *pipe = ctx;
+
+    atomic_store_explicit(&pipe->head, t->head, memory_order_release);
+    pipe_wake(pipe);
+    for (int spins = 0;; spins++) {
+        int ended = atomic_load_explicit(&pipe->ended, memory_order_acquire);
+        size_t tail = atomic_load_explicit(&pipe->tail,
+                                           memory_order_acquire);
+
+        if (tail != t->tail) {
+            t->tail = tail - t->tail > t->batch ? t->tail + t->batch : tail;
+            t->ended = ended && t->tail == tail;
+            return;
+        }
+        if (ended) {
+            t->ended = 1;
+            return;
+        }
+        if (spins < PIPE_SPINS)
+            sched_yield();
+        else
+            pipe_sleep(pipe, &pipe->tail, tail, &pipe->ended);
+    }
+}
+
+struct token_pipe *tokens_pipe(const struct grammar *g, const char *buf,
+                               size_t len, size_t batch,
+                               struct token_buf *t) {
+    struct token_pipe *pipe = xcalloc(1, sizeof *pipe);
+    resize(t, PIPE_BATCHES * batch + 1);
+    t->head = t->tail = 0;
+    t->ended = 0;
+    t->batch = batch;
+    t->fill = take_batch;
+    t->scanner = pipe;
+    t->buf = buf;
+
+    atomic_init(&pipe->tail, 0);
+    atomic_init(&pipe->head, 0);
+    atomic_init(&pipe->ended, 0);
+    atomic_init(&pipe->stop, 0);
+    atomic_init(&pipe->sleeping, 0);
+    pthread_mutex_init(&pipe->lock, NULL);
+    pthread_cond_init(&pipe->moved, NULL);
+    pipe->g = g;
+    pipe->buf = buf;
+    pipe->len = len;
+    pipe->out = (struct token_buf) {
+        .kinds = t->kinds, .offsets = t->offsets, .lengths = t->lengths,
+        .values = t->values, .mask = t->mask, .batch = batch,
+    };
+    if (pthread_create(&pipe->thread, NULL, produce, pipe) != 0) {
+        pthread_mutex_destroy(&pipe->lock);
+        pthread_cond_destroy(&pipe->moved);
+        free(pipe);
+        return NULL;
+    }
+    return pipe;
+}
+
+int tokens_pipe_end(struct token_pipe *pipe) {
+    int failed;
+
+    atomic_store_explicit(&pipe->stop, 1, memory_order_relaxed);
+    pipe_wake(pipe);
+    pthread_join(pipe->thread, NULL);
+    failed = pipe->failed;
+    pthread_mutex_destroy(&pipe->lock);
+    pthread_cond_destroy(&pipe->moved);
+    free(pipe);
+    return failed ? -1 : 0;
+}
@@ -0,0 +1,164 @@
+/*
+ * tokens.h - Tokens scanned ahead of the parse, in batches or on
+ * several threads
+ *
+ * A token_buf holds tokens as a structure of arrays (kinds, offsets,
+ * lengths, values), indexed by absolute counters masked to its
+ * power-of-two capacity.  As a ring it refills itself from the scanner
+ * a batch at a time: the scanner's loop runs alone for a few thousand
+ * tokens (scan_batch, grammar.h), then the parser's, so each keeps its
+ * code and tables in cache instead of the two alternating per token,
+ * and tokens_peek() looks any number of tokens ahead for free.  As a
+ * list it holds a whole buffer's tokens, scanned at once by
+ * tokens_scan() on as many threads as it is given.  tokens_pipe() has a
+ * thread of its own fill a ring while the parser empties it: a single
+ * producer and a single consumer, which only ever publish how far they
+ * got, a batch at a time, with an atomic store each, and sleep only
+ * after spinning a while for the other.
+ *
+ * Scanning is sequential only because of comments: a byte means one
+ * thing inside a block comment and another outside it.  After a newline
+ * nothing else carries over (no token spans a newline, and a // comment
+ * ends at one), so tokens_scan() cuts the buffer into one chunk per
+ * thread just after a newline and has each thread scan its chunk, with
+ * lexer.l's own scanner, under both assumptions:
+ *
+ *   outside a comment  from the chunk's first byte;
+ *   inside one         from just past the first star-slash in it (the
+ *                      whole chunk is comment if there is none), and
+ *                      only until a token starts where one of the
+ *                      outside scan's does: from there on the two are
+ *                      the same tokens.
+ *
+ * A scan that ends in an unclosed comment says so instead of keeping
+ * the scanner's error token for it.  One linear pass then starts at
+ * chunk 0, which is outside, and takes each next chunk's inside or
+ * outside tokens by how the previous one ended.  The result is the
+ * token list a sequential scan gives, error tokens and all: a comment
+ * still open at the end becomes one error token from where it starts
+ * to the end, as the scanner makes it.
+ *
+ * Either way the parser takes its tokens from p->ahead instead of the
+ * scanner, which is why the scanner reports nothing itself (see yylex()
+ * in parser.y).
+ */
+
+#ifndef TOKENS_H
+#define TOKENS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "number.h"
+#include "parser.h"
+#include "strbuf.h"
+
+/* Chunks are no smaller: below twice this a buffer is scanned whole
+   (tests/scan sets it small, to cut small buffers into many chunks) */
+#ifndef TOKENS_CHUNK_MIN
+#define TOKENS_CHUNK_MIN (1 << 20)
+#endif
+
+/* Tokens a ring scans at a time by default (parser.h, token_batch) */
+#define TOKENS_BATCH 1024
+
+/* Buffers worth scanning on a thread of their own, while they are
+   parsed (parser.h, lex_pipe): from this size, starting the thread
+   is small next to the parse (make bench-pipe times both ways from
+   64 KB up) */
+#define TOKENS_PIPE_MIN (1 << 20)
+
+struct token_buf {
+    uint16_t       *kinds;      /* the dialect's token number, as yylex()
+                                   returns it (0 at the end)           */
+    size_t         *offsets;    /* where each starts                   */
+    uint32_t       *lengths;    /* in bytes (an unterminated comment of
+                                   4 GB or more is cut short)          */
+    struct number  *values;     /* NUM only                            */
+    size_t          mask;       /* capacity - 1: token i is at i & mask */
+    size_t          head;       /* tokens the parser has taken         */
+    size_t          tail;       /* ... and scanned                     */
+    int             ended;      /* the end token is the last scanned   */
+    size_t          batch;      /* scanned at most at a time (0: all
+                                   there is room for)                  */
+
+    /* A ring scans more with fill(scanner, t) as the parser needs
+       them; a list (fill NULL) has them all */
+    void          (*fill)(void *scanner, struct token_buf *t);
+    void           *scanner;
+    const char     *buf;        /* the text they were scanned from     */
+    struct strbuf   text;       /* the text of the last one taken      */
+};
+
+/* Make t a ring of at least batch tokens that fill() scans from the
+   scanner's buffer, buf (exits on out-of-memory) */
+void tokens_ring(struct token_buf *t, size_t batch,
+                 void (*fill)(void *scanner, struct token_buf *t),
+                 void *scanner, const char *buf);
+
+/* Room for n more tokens after tail, in a list (exits on
+   out-of-memory) */
+void tokens_reserve(struct token_buf *t, size_t n);
+
+void tokens_free(struct token_buf *t);
+
+/* Tokens fill() may scan before the ring is full: the last one taken
+   stays, for diagnostics */
+static inline size_t tokens_room(const struct token_buf *t) {
+    return t->mask - (t->tail - t->head);
+}
+
+/* ... and in its next batch */
+static inline size_t tokens_batch(const struct token_buf *t) {
+    size_t n = tokens_room(t);
+    return t->batch && t->batch < n ? t->batch : n;
+}
+
+/*
+ * Scan buf[0..len), followed by two NULs, with grammar g on up to
+ * nthreads threads into the list t, ending with the end token.  The
+ * buffer is not written to.  Returns the number of chunks it was cut
+ * into.
+ */
+int tokens_scan(const struct grammar *g, const char *buf, size_t len,
+                int nthreads, struct token_buf *t);
+
+/*
+ * Scan buf[0..len), followed by two NULs, with grammar g on a thread of
+ * its own into the ring t, batch tokens at a time, while the caller
+ * takes them: t is set up to wait for each batch.  The thread copies
+ * the buffer a piece at a time into its scanner's own, so the buffer is
+ * not written to.  NULL if the thread could not be started.
+ */
+struct token_pipe *tokens_pipe(const struct grammar *g, const char *buf,
+                               size_t len, size_t batch,
+                               struct token_buf *t);
+
+/* Stop the scan if it is still going and wait for its thread: -1 if
+   its scanner could not take the buffer (t then holds just the end
+   token) */
+int tokens_pipe_end(struct token_pipe *pipe);
+
+/* The index of the next token, for the parser: the end token is taken
+   again and again once reached */
+static inline size_t tokens_take(struct token_buf *t) {
+    if (t->head == t->tail && !t->ended)
+        t->fill(t->scanner, t);
+    return (t->head < t->tail ? t->head++ : t->tail - 1) & t->mask;
+}
+
+/* The kind of the token k after the next one (k = 0: the next), which
+   a ring scans ahead for if need be: k must be less than its batch */
+static inline int tokens_peek(struct token_buf *t, size_t k) {
+    while (t->head + k >= t->tail && !t->ended)
+        t->fill(t->scanner, t);
+    return t->kinds[(t->head + k < t->tail ? t->head + k : t->tail - 1) &
+                    t->mask];
+}
+
+/* The last token taken: its offset and its text (NUL-terminated, valid
+   until the next call) */
+size_t tokens_start(const struct token_buf *t);
+const char *tokens_text(struct token_buf *t);
+
+#endif /* TOKENS_H */
@@ -0,0 +1,358 @@
+/*
+ * watch.c - Continuous validation of a directory (c_parser --watch)
+ *
+ * Validates every .c file under the directory once, then sleeps on
+ * inotify and revalidates a file only when it has been written (closed
+ * after writing, or renamed into place).  One parser instance and one
+ * input buffer serve every run, so after the first few files nothing
+ * is allocated per check.  A line is printed for a file only when its
+ * verdict changes:
+ *
+ *     gen/a.c: Syntax valid.
+ *     gen/b.c: Syntax error at line 3, token : 'b'
+ *     gen/b.c: removed
+ *
+ * Subdirectories are watched too, including ones created later.  Files
+ * and directories whose names start with '.' (editor temporaries) and
+ * symbolic links are skipped.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "watch.h"
+#include "strbuf.h"
+
+#define DIR_EVENTS  (IN_CREATE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | \
+                     IN_CLOSE_WRITE | IN_DELETE_SELF | IN_ONLYDIR)
+
+/* Last verdict printed for a file */
+struct verdict {
+    char   *path;       /* NULL: free slot                          */
+    int     status;     /* -1 none (removed), 0 valid, 1 error,
+                           2 unreadable                             */
+    char   *diag;       /* what was printed for status != 0         */
+};
+
+struct watcher {
+    struct parser  *parser;
+    int             fd;         /* inotify instance                 */
+    int             root;       /* watch descriptor of the top dir  */
+    char          **dirs;       /* path of each watch descriptor    */
+    int             ndirs;
+    struct verdict *files;      /* open-addressed on path           */
+    size_t          cap;
+    size_t          used;
+    struct strbuf   src;        /* file text, reused                */
+    struct strbuf   path;       /* scratch for joined paths         */
+};
+
+static int is_source(const char *name) {
+    size_t len = strlen(name);
+    return name[0] != '.' && len > 2 && strcmp(name + len - 2, ".c") == 0;
+}
+
+static const char *join(struct watcher *w, const char *dir, const char *name) {
+    strbuf_reset(&w->path);
+    strbuf_addf(&w->path, "%s/%s", dir, name);
+    return w->path.data;
+}
+
+/* ================================================================
+   Verdicts by path
+   ================================================================ */
+
+static size_t hash_path(const char *s) {
+    size_t h = 14695981039346656037ULL;     /* FNV-1a */
+    while (*s)
+        h = (h ^ (unsigned char) *s++) * 1099511628211ULL;
+    return h;
+}
+
+static struct verdict *find(const struct watcher *w, const char *path) {
+    size_t i = hash_path(path) & (w->cap - 1);
+    while (w->files[i].path && strcmp(w->files[i].path, path) != 0)
+        i = (i + 1) & (w->cap - 1);
+    return &w->files[i];
+}
+
+/* The entry for path, added (with no verdict yet) if it is new */
+static struct verdict *lookup(struct watcher *w, const char *path) {
+    struct verdict *v = w->cap ? find(w, path) : NULL;
+
+    if (v && v->path)
+        return v;
+    if (2 * (w->used + 1) > w->cap) {
+        struct verdict *old = w->files;
+        size_t old_cap = w->cap;
+
+        w->cap = old_cap ? 2 * old_cap : 1024;
+        w->files = xcalloc(w->cap, sizeof *w->files);
+        for (size_t i = 0; i < old_cap; i++) {
+            if (!old[i].path)
+                continue;
+            size_t j = hash_path(old[i].path) & (w->cap - 1);
+            while (w->files[j].path)
+                j = (j + 1) & (w->cap - 1);
+            w->files[j] = old[i];
+        }
+        free(old);
+        v = find(w, path);
+    }
+    v->path   = xstrdup(path);
+    v->status = -1;
+    w->used++;
+    return v;
+}
+
+/* Print the verdict if it differs from the last one for path */
+static void report(struct watcher *w, const char *path,
+                   int status, const char *diag) {
+    struct verdict *v = lookup(w, path);
+
+    if (v->status == status &&
+        (status <= 0 || strcmp(v->diag, diag) == 0))
+        return;
+    free(v->diag);
+    v->status = status;
+    v->diag   = status > 0 ? xstrdup(diag) : NULL;
+
+    if (status < 0) {
+        printf("%s: removed\n", path);
+    } else if (status == 0) {
+        printf("%s: Syntax valid.\n", path);
+    } else {
+        /* one line per diagnostic line */
+        for (const char *line = diag; *line; ) {
+            const char *nl = strchr(line, '\n');
+            int len = nl ? (int) (nl - line) : (int) strlen(line);
+            printf("%s: %.*s\n", path, len, line);
+            line += nl ? len + 1 : len;
+        }
+    }
+}
+
+static void check_file(struct watcher *w, const char *path) {
+    struct parser *p = w->parser;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+        if (errno == ENOENT)
+            report(w, path, -1, NULL);
+        else
+            report(w, path, 2, strerror(errno));
+        return;
+    }
+    strbuf_reset(&w->src);
+    if (strbuf_read_fd(&w->src, fd) < 0) {
+        report(w, path, 2, strerror(errno));
+        close(fd);
+        return;
+    }
+    close(fd);
+
+    /* flex scans the buffer in place: it needs two NULs at the end */
+    strbuf_reserve(&w->src, 2);
+    w->src.data[w->src.len] = w->src.data[w->src.len + 1] = '\0';
+
+    p->diag_out = NULL;
+    int result = parser_parse_buffer(p, w->src.data, w->src.len);
+    strbuf_add(&p->diag, "", 1);
+    report(w, path, result ? 1 : 0, p->diag.data);
+}
+
+/* ================================================================
+   Directories
+   ================================================================ */
+
+static int add_watch(struct watcher *w, const char *dir) {
+    int wd = inotify_add_watch(w->fd, dir, DIR_EVENTS);
+    if (wd < 0) {
+        fprintf(stderr, "%s: %s\n", dir, strerror(errno));
+        return -1;
+    }
+    if (wd >= w->ndirs) {
+        int n = w->ndirs ? w->ndirs : 64;
+        while (n <= wd)
+            n *= 2;
+        w->dirs = xrealloc(w->dirs, n * sizeof *w->dirs);
+        memset(w->dirs + w->ndirs, 0, (n - w->ndirs) * sizeof *w->dirs);
+        w->ndirs = n;
+    }
+    free(w->dirs[wd]);
+    w->dirs[wd] = xstrdup(dir);
+    return wd;
+}
+
+/* Watch dir and everything under it, and check its files; returns the
+   watch descriptor.  The watch goes in before the listing, so a file
+   written in between is seen twice at worst, never missed. */
+static int watch_dir(struct watcher *w, const char *dir) {
+    struct dirent **names;
+    int wd, n;
+
+    wd = add_watch(w, dir);
+    if (wd < 0)
+        return -1;
+    n = scandir(dir, &names, NULL, alphasort);
+    if (n < 0) {
+        fprintf(stderr, "%s: %s\n", dir, strerror(errno));
+        return wd;
+    }
+    for (int i = 0; i < n; i++) {
+        const char *name = names[i]->d_name;
+        char *path = xstrdup(join(w, dir, name));
+        struct stat st;
+
+        if (name[0] != '.' && lstat(path, &st) == 0) {
+            if (S_ISDIR(st.st_mode))
+                watch_dir(w, path);
+            else if (S_ISREG(st.st_mode) && is_source(name))
+                check_file(w, path);
+        }
+        free(path);
+        free(names[i]);
+    }
+    free(names);
+    return wd;
+}
+
+/* ================================================================
+   Events
+   ================================================================ */
+
+static int is_under(const char *path, const char *dir, size_t len) {
+    return strncmp(path, dir, len) == 0 &&
+           (path[len] == '/' || path[len] == '\0');
+}
+
+/* A directory was deleted or moved away, and its files with it */
+static void forget_dir(struct watcher *w, const char *dir) {
+    size_t len = strlen(dir);
+
+    for (int wd = 0; wd < w->ndirs; wd++)
+        if (w->dirs[wd] && is_under(w->dirs[wd], dir, len))
+            inotify_rm_watch(w->fd, wd);    /* IN_IGNORED frees it */
+    for (size_t i = 0; i < w->cap; i++) {
+        struct verdict *v = &w->files[i];
+        if (v->path && v->status >= 0 && is_under(v->path, dir, len))
+            report(w, v->path, -1, NULL);
+    }
+}
+
+/* Events were dropped: check everything again (only changed verdicts
+   print).  Watching a directory twice keeps its watch descriptor. */
+static void rescan(struct watcher *w) {
+    for (size_t i = 0; i < w->cap; i++) {
+        struct verdict *v = &w->files[i];
+        if (v->path && v->status >= 0 && access(v->path, F_OK) != 0)
+            report(w, v->path, -1, NULL);
+    }
+    char *top = xstrdup(w->dirs[w->root]);
+    watch_dir(w, top);
+    free(top);
+}
+
+static void handle(struct watcher *w, const struct inotify_event *ev) {
+    const char *dir = ev->wd < w->ndirs ? w->dirs[ev->wd] : NULL;
+
+    if (ev->mask & IN_IGNORED) {
+        /* directory gone: its files have reported themselves */
+        if (ev->wd < w->ndirs) {
+            free(w->dirs[ev->wd]);
+            w->dirs[ev->wd] = NULL;
+        }
+        return;
+    }
+    if (!dir || ev->len == 0 || ev->name[0] == '.')
+        return;
+
+    const char *path = join(w, dir, ev->name);
+    if (ev->mask & IN_ISDIR) {
+        char *copy = xstrdup(path);
+        if (ev->mask & (IN_CREATE | IN_MOVED_TO))
+            watch_dir(w, copy);
+        else if (ev->mask & (IN_DELETE | IN_MOVED_FROM))
+            forget_dir(w, copy);
+        free(copy);
+    } else if (is_source(ev->name)) {
+        if (ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+            check_file(w, path);
+        else if (ev->mask & (IN_DELETE | IN_MOVED_FROM))
+            report(w, path, -1, NULL);
+    }
+}
+
+int watch_main(struct parser *p, const char *dir) {
+    static char buf[64 * 1024]
+        __attribute__((aligned(__alignof__(struct inotify_event))));
+    struct watcher w = { .parser = p };
+    int status = 0;
+    size_t len = strlen(dir);
+
+    w.fd = inotify_init1(IN_CLOEXEC);
+    if (w.fd < 0) {
+        perror("inotify");
+        return 2;
+    }
+
+    /* "gen/" and "gen" name the same files */
+    while (len > 1 && dir[len - 1] == '/')
+        len--;
+    char *top = strndup(dir, len);
+    if (!top)
+        out_of_memory();
+    w.root = watch_dir(&w, top);
+    free(top);
+    if (w.root < 0) {
+        close(w.fd);
+        return 2;
+    }
+    fflush(stdout);
+
+    for (;;) {
+        ssize_t n = read(w.fd, buf, sizeof buf);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("inotify");
+            status = 2;
+            break;
+        }
+        for (char *at = buf; at < buf + n; ) {
+            const struct inotify_event *ev = (const void *) at;
+            at += sizeof *ev + ev->len;
+
+            if (ev->mask & IN_Q_OVERFLOW) {
+                rescan(&w);
+            } else if (ev->wd == w.root &&
+                       (ev->mask & (IN_DELETE_SELF | IN_IGNORED))) {
+                goto done;      /* the directory itself is gone */
+            } else {
+                handle(&w, ev);
+            }
+        }
+        fflush(stdout);
+    }
+
+done:
+    for (int i = 0; i < w.ndirs; i++)
+        free(w.dirs[i]);
+    free(w.dirs);
+    for (size_t i = 0; i < w.cap; i++) {
+        free(w.files[i].path);
+        free(w.files[i].diag);
+    }
+    free(w.files);
+    strbuf_free(&w.src);
+    strbuf_free(&w.path);
+    close(w.fd);
+    return status;
+}
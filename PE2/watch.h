@@ -0,0 +1,14 @@
+/*
+ * watch.h - Continuous validation of a directory (c_parser --watch)
+ */
+
+#ifndef WATCH_H
+#define WATCH_H
+
+#include "parser.h"
+
+/* Validate every .c file under dir, then revalidate files as they are
+   written, until dir goes away; returns the exit status */
+int watch_main(struct parser *p, const char *dir);
+
+#endif /* WATCH_H */